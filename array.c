@@ -92,6 +92,20 @@ void GridTr_array_add(struct GridTr_array_s *array, const void *elem) {
   array->num_elems++;
 }
 
+void GridTr_array_reserve(struct GridTr_array_s *array, uint32 max_elems) {
+  if (!array || max_elems <= array->max_elems)
+    return;
+  void *new_data = GridTr_new(array->elem_size * max_elems);
+  if (!new_data) {
+    printf("allocation failure...\n");
+    return;
+  }
+  memcpy(new_data, array->data, array->elem_size * array->num_elems);
+  GridTr_free(array->data);
+  array->data = new_data;
+  array->max_elems = max_elems;
+}
+
 void GridTr_array_swap_free(struct GridTr_array_s *array, uint32 index) {
   if (!array || index >= array->num_elems)
     return;
@@ -24,6 +24,9 @@ void GridTr_destroy_array(struct GridTr_array_s **array);
 
 void GridTr_array_add(struct GridTr_array_s *array, const void *elem);
 
+// grows the storage to hold at least max_elems, one allocation
+void GridTr_array_reserve(struct GridTr_array_s *array, uint32 max_elems);
+
 void *GridTr_array_get(struct GridTr_array_s *array, uint32 index);
 
 void GridTr_destroy_array_dtor(struct GridTr_array_s **array,
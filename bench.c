@@ -0,0 +1,427 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mgrid.h"
+#include "packet.h"
+#include "pool.h"
+#include "query.h"
+#include "vec.inl"
+
+// timings for the grid queries on a procedural scene. build with bench.sh
+
+static double bench_now_ms(void) {
+  struct timespec ts;
+  timespec_get(&ts, TIME_UTC);
+  return (double)ts.tv_sec * 1000.0 + (double)ts.tv_nsec / 1e6;
+}
+
+static float bench_randf(uint32 *state, float lo, float hi) {
+  *state = *state * 1664525u + 1013904223u;
+  return lo + (hi - lo) * (float)(*state >> 8) / (float)(1u << 24);
+}
+
+static float bench_height(int x, int y) {
+  return 2.0f * sinf((float)x * 0.21f) * cosf((float)y * 0.17f);
+}
+
+// size x size quads of rolling terrain, two triangles each
+static void bench_make_terrain(struct GridTr_collider_s **colls, uint32 *n,
+                               int size) {
+  *n = (uint32)(size * size * 2);
+  *colls = GridTr_new(*n * sizeof(struct GridTr_collider_s));
+  uint32 at = 0;
+  for (int y = 0; y < size; y++) {
+    for (int x = 0; x < size; x++) {
+      struct vec3_s q[4] = {
+          {{{(float)x, (float)y, bench_height(x, y)}}},
+          {{{(float)x + 1, (float)y, bench_height(x + 1, y)}}},
+          {{{(float)x + 1, (float)y + 1, bench_height(x + 1, y + 1)}}},
+          {{{(float)x, (float)y + 1, bench_height(x, y + 1)}}},
+      };
+      struct vec3_s tris[2][3] = {{q[0], q[1], q[2]}, {q[0], q[2], q[3]}};
+      for (int t = 0; t < 2; t++) {
+        struct vec3_s nrm = vec3_cross(point_vec(tris[t][0], tris[t][1]),
+                                       point_vec(tris[t][0], tris[t][2]));
+        GridTr_create_collider(&(*colls)[at], at, tris[t], 3,
+                               GridTr_create_plane(nrm, tris[t][0]));
+        at++;
+      }
+    }
+  }
+}
+
+static void bench_free_colliders(struct GridTr_collider_s *colls, uint32 n) {
+  for (uint32 i = 0; i < n; i++)
+    GridTr_destroy_collider(&colls[i]);
+  GridTr_free(colls);
+}
+
+// long rays skimming over the terrain
+static struct GridTr_rayseg_s *bench_make_rays(uint32 num_rays, int size) {
+  struct GridTr_rayseg_s *rays =
+      GridTr_new(num_rays * sizeof(struct GridTr_rayseg_s));
+  uint32 rng = 1234;
+  float s = (float)size;
+  for (uint32 i = 0; i < num_rays; i++) {
+    struct vec3_s p0 = vec3_set(bench_randf(&rng, 0.0f, s),
+                                bench_randf(&rng, 0.0f, s),
+                                bench_randf(&rng, 1.0f, 4.0f));
+    struct vec3_s p1 = vec3_set(bench_randf(&rng, 0.0f, s),
+                                bench_randf(&rng, 0.0f, s),
+                                bench_randf(&rng, -3.0f, 2.0f));
+    rays[i] = GridTr_create_rayseg(p0, p1);
+  }
+  return rays;
+}
+
+static void bench_build_grid(struct GridTr_grid_s *grid,
+                             const struct GridTr_collider_s *colls, uint32 n,
+                             enum GridTr_cell_key_e cell_key) {
+  GridTr_create_grid(grid, 1.0f);
+  GridTr_grid_set_cell_key(grid, cell_key);
+  for (uint32 i = 0; i < n; i++)
+    GridTr_add_collider_to_grid(grid, &colls[i]);
+}
+
+static double bench_trace(const struct GridTr_grid_s *grid,
+                          const struct GridTr_rayseg_s *rays, uint32 num_rays,
+                          uint32 *num_hits) {
+  struct GridTr_hit_s hit;
+  *num_hits = 0;
+  double t0 = bench_now_ms();
+  for (uint32 i = 0; i < num_rays; i++)
+    *num_hits += GridTr_raycast_closest(grid, &rays[i], &hit) ? 1 : 0;
+  return bench_now_ms() - t0;
+}
+
+static void bench_cell_keys(void) {
+  // morton keys only pay off on frozen grids whose cells outgrow the
+  // caches, so a small scene and a large one
+  const int sizes[2] = {48, 384};
+  const uint32 rays_per_size[2] = {200000, 40000};
+  for (int s = 0; s < 2; s++) {
+    const uint32 num_rays = rays_per_size[s];
+    struct GridTr_collider_s *colls;
+    uint32 n;
+    bench_make_terrain(&colls, &n, sizes[s]);
+    struct GridTr_rayseg_s *rays = bench_make_rays(num_rays, sizes[s]);
+
+    printf("[bench] cell keys: %u colliders, %u rays\n", n, num_rays);
+    const char *names[2] = {"fnv1a ", "morton"};
+    enum GridTr_cell_key_e keys[2] = {GridTr_CELL_KEY_FNV1A,
+                                      GridTr_CELL_KEY_MORTON};
+    for (int k = 0; k < 2; k++) {
+      struct GridTr_grid_s grid;
+      bench_build_grid(&grid, colls, n, keys[k]);
+      uint32 hits;
+      double ms = bench_trace(&grid, rays, num_rays, &hits);
+      printf(" * %s hashed: %8.2f ms (%u hits)\n", names[k], ms, hits);
+      GridTr_grid_freeze(&grid);
+      ms = bench_trace(&grid, rays, num_rays, &hits);
+      printf(" * %s frozen: %8.2f ms (%u hits)\n", names[k], ms, hits);
+      GridTr_destroy_grid(&grid);
+    }
+
+    GridTr_free(rays);
+    bench_free_colliders(colls, n);
+  }
+}
+
+static void bench_build(void) {
+  const int size = 192;
+  struct GridTr_collider_s *colls;
+  uint32 n;
+  bench_make_terrain(&colls, &n, size);
+
+  printf("[bench] build: %u colliders\n", n);
+  struct GridTr_grid_s grid;
+  double t0 = bench_now_ms();
+  bench_build_grid(&grid, colls, n, GridTr_CELL_KEY_FNV1A);
+  printf(" * serial    : %8.2f ms\n", bench_now_ms() - t0);
+  GridTr_destroy_grid(&grid);
+  GridTr_create_grid(&grid, 1.0f);
+  t0 = bench_now_ms();
+  GridTr_build_grid(&grid, colls, n);
+  printf(" * bulk      : %8.2f ms\n", bench_now_ms() - t0);
+  GridTr_destroy_grid(&grid);
+  for (uint32 threads = 1; threads <= 8; threads *= 2) {
+    struct GridTr_thread_pool_s *pool = GridTr_create_thread_pool(threads);
+    GridTr_create_grid(&grid, 1.0f);
+    t0 = bench_now_ms();
+    GridTr_build_grid_parallel(pool, &grid, colls, n);
+    printf(" * %u thread%s: %8.2f ms\n", threads, threads > 1 ? "s" : " ",
+           bench_now_ms() - t0);
+    GridTr_destroy_grid(&grid);
+    GridTr_destroy_thread_pool(&pool);
+  }
+  bench_free_colliders(colls, n);
+}
+
+// slanted quads a few cells across, box against voxelized insertion
+static void bench_insert_modes(void) {
+  const uint32 n = 4000;
+  struct GridTr_collider_s *colls =
+      GridTr_new(n * sizeof(struct GridTr_collider_s));
+  uint32 rng = 77;
+  for (uint32 i = 0; i < n; i++) {
+    struct vec3_s o = vec3_set(bench_randf(&rng, 0.0f, 64.0f),
+                               bench_randf(&rng, 0.0f, 64.0f),
+                               bench_randf(&rng, 0.0f, 64.0f));
+    struct vec3_s u = vec3_norm(vec3_set(bench_randf(&rng, -1.0f, 1.0f),
+                                         bench_randf(&rng, -1.0f, 1.0f),
+                                         bench_randf(&rng, -1.0f, 1.0f)));
+    struct vec3_s v = vec3_norm(vec3_cross(u, vec3_set(0.3f, 1.0f, 0.5f)));
+    u = vec3_mul(u, bench_randf(&rng, 2.0f, 8.0f));
+    v = vec3_mul(v, bench_randf(&rng, 2.0f, 8.0f));
+    struct vec3_s q[4] = {o, vec3_add(o, u), vec3_add(vec3_add(o, u), v),
+                          vec3_add(o, v)};
+    GridTr_create_collider(&colls[i], i, q, 4,
+                           GridTr_create_plane(vec3_cross(u, v), q[0]));
+  }
+
+  printf("[bench] insert modes: %u slanted quads\n", n);
+  const char *names[2] = {"voxelize", "box     "};
+  enum GridTr_insert_mode_e modes[2] = {GridTr_INSERT_VOXELIZE,
+                                        GridTr_INSERT_BOX};
+  for (int m = 0; m < 2; m++) {
+    struct GridTr_grid_s grid;
+    GridTr_create_grid(&grid, 1.0f);
+    grid.insert_mode = modes[m];
+    double t0 = bench_now_ms();
+    GridTr_build_grid(&grid, colls, n);
+    double ms = bench_now_ms() - t0;
+    uint32 num_cells, num_refs = 0;
+    const void **cells = GridTr_grid_get_all_grid_cells(&grid, &num_cells);
+    for (uint32 i = 0; i < num_cells; i++)
+      num_refs += ((const struct GridTr_grid_cell_s *)cells[i])->num_colliders;
+    GridTr_free(cells);
+    printf(" * %s: %8.2f ms (%u cells, %u refs)\n", names[m], ms, num_cells,
+           num_refs);
+    GridTr_destroy_grid(&grid);
+  }
+  bench_free_colliders(colls, n);
+}
+
+// terrain clutter under a few huge slanted polygons
+// times one ray set through each, then counts its polygon tests off the clock
+static void bench_mgrid_trace(const char *set,
+                              const struct GridTr_grid_s *grids[2],
+                              const struct GridTr_mgrid_s *mgrid,
+                              const struct GridTr_rayseg_s *rays,
+                              uint32 num_rays) {
+  const char *names[2] = {"grid 1.0 ", "grid auto"};
+  struct GridTr_hit_s hit;
+  for (int g = 0; g < 2; g++) {
+    uint32 hits, num_tests = 0;
+    double ms = bench_trace(grids[g], rays, num_rays, &hits);
+    for (uint32 i = 0; i < num_rays; i++)
+      GridTr_raycast_closest_counted(grids[g], &rays[i], &hit, &num_tests);
+    printf(" * %s, %s: %8.2f ms (%u hits, %6.2f tests/ray)\n", set, names[g],
+           ms, hits, (double)num_tests / num_rays);
+  }
+  uint32 hits = 0, num_tests = 0;
+  double t0 = bench_now_ms();
+  for (uint32 i = 0; i < num_rays; i++)
+    hits += GridTr_mgrid_raycast_closest(mgrid, &rays[i], &hit) ? 1 : 0;
+  double ms = bench_now_ms() - t0;
+  for (uint32 i = 0; i < num_rays; i++)
+    GridTr_mgrid_raycast_closest_counted(mgrid, &rays[i], &hit, &num_tests);
+  printf(" * %s, mgrid    : %8.2f ms (%u hits, %6.2f tests/ray)\n", set, ms,
+         hits, (double)num_tests / num_rays);
+}
+
+static void bench_mgrid(void) {
+  const int size = 48;
+  const uint32 num_rays = 200000;
+  struct GridTr_collider_s *terrain;
+  uint32 num_terrain;
+  bench_make_terrain(&terrain, &num_terrain, size);
+  uint32 n = num_terrain + 4;
+  struct GridTr_collider_s *colls = GridTr_new(n * sizeof(*colls));
+  memcpy(colls, terrain, num_terrain * sizeof(*colls));
+  GridTr_free(terrain);
+  for (uint32 i = 0; i < 4; i++) {
+    float z = 6.0f + (float)i * 2.0f;
+    struct vec3_s tri[3] = {{{{-10.0f, -10.0f, z}}},
+                            {{{(float)size + 10.0f, -10.0f, z + 1.0f}}},
+                            {{{-10.0f, (float)size + 10.0f, z - 1.0f}}}};
+    struct vec3_s nrm =
+        vec3_cross(point_vec(tri[0], tri[1]), point_vec(tri[0], tri[2]));
+    GridTr_create_collider(&colls[num_terrain + i], num_terrain + i, tri, 3,
+                           GridTr_create_plane(nrm, tri[0]));
+  }
+  // rays starting in the terrain clutter, and rays coming down onto it
+  // through the big triangles
+  struct GridTr_rayseg_s *rays = bench_make_rays(num_rays, size);
+  struct GridTr_rayseg_s *down_rays =
+      GridTr_new(num_rays * sizeof(struct GridTr_rayseg_s));
+  uint32 rng = 4321;
+  for (uint32 i = 0; i < num_rays; i++) {
+    float x = bench_randf(&rng, 0.0f, (float)size);
+    float y = bench_randf(&rng, 0.0f, (float)size);
+    down_rays[i] = GridTr_create_rayseg(
+        vec3_set(x, y, 16.0f), vec3_set(x + bench_randf(&rng, -4.0f, 4.0f),
+                                        y + bench_randf(&rng, -4.0f, 4.0f),
+                                        -3.0f));
+  }
+  printf("[bench] mgrid: %u colliders, %u rays per set\n", n, num_rays);
+
+  // the same terrain cells as the mgrid's finest level, and the size
+  // GridTr_suggest_cell_size() picks once the big triangles are in
+  struct GridTr_grid_s grids[2];
+  float cell_sizes[2] = {1.0f, GridTr_CELL_SIZE_AUTO};
+  for (int g = 0; g < 2; g++) {
+    GridTr_create_grid(&grids[g], cell_sizes[g]);
+    double t0 = bench_now_ms();
+    GridTr_build_grid(&grids[g], colls, n);
+    printf(" * build grid %4.2f: %8.2f ms\n", grids[g].cell_size,
+           bench_now_ms() - t0);
+  }
+  struct GridTr_mgrid_s mgrid;
+  GridTr_create_mgrid(&mgrid, 1.0f, 4, 4);
+  double t0 = bench_now_ms();
+  GridTr_build_mgrid(&mgrid, colls, n);
+  printf(" * build mgrid    : %8.2f ms\n", bench_now_ms() - t0);
+  const struct GridTr_grid_s *grid_ptrs[2] = {&grids[0], &grids[1]};
+  bench_mgrid_trace("clutter", grid_ptrs, &mgrid, rays, num_rays);
+  bench_mgrid_trace("down   ", grid_ptrs, &mgrid, down_rays, num_rays);
+  GridTr_destroy_grid(&grids[0]);
+  GridTr_destroy_grid(&grids[1]);
+  GridTr_destroy_mgrid(&mgrid);
+
+  GridTr_free(down_rays);
+  GridTr_free(rays);
+  bench_free_colliders(colls, n);
+}
+
+// the same rays one call each, as one structure of arrays batch and as
+// that batch spread over a growing pool
+static void bench_batch(void) {
+  const int size = 48;
+  const uint32 num_rays = 200000;
+  struct GridTr_collider_s *colls;
+  uint32 n;
+  bench_make_terrain(&colls, &n, size);
+  struct GridTr_rayseg_s *rays = bench_make_rays(num_rays, size);
+  printf("[bench] batch: %u colliders, %u rays\n", n, num_rays);
+  float *soa = GridTr_new(7 * num_rays * sizeof(float));
+  for (uint32 i = 0; i < num_rays; i++) {
+    soa[i] = rays[i].o.x;
+    soa[num_rays + i] = rays[i].o.y;
+    soa[2 * num_rays + i] = rays[i].o.z;
+    soa[3 * num_rays + i] = rays[i].d.x;
+    soa[4 * num_rays + i] = rays[i].d.y;
+    soa[5 * num_rays + i] = rays[i].d.z;
+    soa[6 * num_rays + i] = rays[i].len;
+  }
+  struct GridTr_batch_hit_s *hits =
+      GridTr_new(num_rays * sizeof(struct GridTr_batch_hit_s));
+
+  struct GridTr_grid_s grid;
+  GridTr_create_grid(&grid, 1.0f);
+  GridTr_build_grid(&grid, colls, n);
+  uint32 num_hits;
+  double ms = bench_trace(&grid, rays, num_rays, &num_hits);
+  printf(" * per ray: %8.2f ms (%u hits)\n", ms, num_hits);
+  double t0 = bench_now_ms();
+  num_hits = GridTr_trace_batch(&grid, soa, soa + num_rays, soa + 2 * num_rays,
+                                soa + 3 * num_rays, soa + 4 * num_rays,
+                                soa + 5 * num_rays, soa + 6 * num_rays,
+                                num_rays, hits);
+  printf(" * batch  : %8.2f ms (%u hits)\n", bench_now_ms() - t0, num_hits);
+
+  // scaling over worker counts, the pool is made up front like a frame loop
+  // would keep it
+  double base_ms = 0.0;
+  for (uint32 threads = 1; threads <= 32; threads *= 2) {
+    struct GridTr_thread_pool_s *pool = GridTr_create_thread_pool(threads);
+    t0 = bench_now_ms();
+    num_hits = GridTr_trace_batch_parallel(
+        pool, &grid, soa, soa + num_rays, soa + 2 * num_rays,
+        soa + 3 * num_rays, soa + 4 * num_rays, soa + 5 * num_rays,
+        soa + 6 * num_rays, num_rays, hits);
+    double ms = bench_now_ms() - t0;
+    if (threads == 1)
+      base_ms = ms;
+    printf(" * %2u threads: %8.2f ms, %5.2fx (%u hits)\n", threads, ms,
+           base_ms / ms, num_hits);
+    GridTr_destroy_thread_pool(&pool);
+  }
+  GridTr_destroy_grid(&grid);
+
+  GridTr_free(hits);
+  GridTr_free(soa);
+  GridTr_free(rays);
+  bench_free_colliders(colls, n);
+}
+
+// camera rays over the terrain, neighbours in the batch are neighbours on
+// screen so packets stay together
+static void bench_packets(void) {
+  const int size = 48;
+  const uint32 w = 512, h = 384, num_rays = w * h;
+  struct GridTr_collider_s *colls;
+  uint32 n;
+  bench_make_terrain(&colls, &n, size);
+  struct GridTr_grid_s grid;
+  GridTr_create_grid(&grid, 1.0f);
+  GridTr_build_grid(&grid, colls, n);
+  printf("[bench] packets: %u colliders, %ux%u camera rays, %u wide\n", n, w, h,
+         GridTr_PACKET_SIZE);
+
+  float *soa = GridTr_new(7 * num_rays * sizeof(float));
+  struct vec3_s eye = vec3_set(-4.0f, -4.0f, 12.0f);
+  for (uint32 i = 0; i < num_rays; i++) {
+    struct vec3_s to = vec3_set((float)(i % w) / (float)w * (float)size,
+                                (float)(i / w) / (float)h * (float)size, -2.0f);
+    struct GridTr_rayseg_s seg = GridTr_create_rayseg(eye, to);
+    for (int k = 0; k < 3; k++) {
+      soa[k * num_rays + i] = seg.o.xyz[k];
+      soa[(3 + k) * num_rays + i] = seg.d.xyz[k];
+    }
+    soa[6 * num_rays + i] = seg.len;
+  }
+  struct GridTr_batch_hit_s *hits =
+      GridTr_new(num_rays * sizeof(struct GridTr_batch_hit_s));
+  double t0 = bench_now_ms();
+  uint32 num_hits = GridTr_trace_batch(
+      &grid, soa, soa + num_rays, soa + 2 * num_rays, soa + 3 * num_rays,
+      soa + 4 * num_rays, soa + 5 * num_rays, soa + 6 * num_rays, num_rays,
+      hits);
+  printf(" * single : %8.2f ms (%u hits)\n", bench_now_ms() - t0, num_hits);
+  t0 = bench_now_ms();
+  num_hits = GridTr_trace_batch_packets(
+      &grid, soa, soa + num_rays, soa + 2 * num_rays, soa + 3 * num_rays,
+      soa + 4 * num_rays, soa + 5 * num_rays, soa + 6 * num_rays, num_rays,
+      hits);
+  printf(" * packets: %8.2f ms (%u hits)\n", bench_now_ms() - t0, num_hits);
+  t0 = bench_now_ms();
+  GridTr_grid_build_tri_packets(&grid);
+  printf(" * tri packets built in %.2f ms (%u)\n", bench_now_ms() - t0,
+         grid.num_tri_packets);
+  t0 = bench_now_ms();
+  num_hits = GridTr_trace_batch(
+      &grid, soa, soa + num_rays, soa + 2 * num_rays, soa + 3 * num_rays,
+      soa + 4 * num_rays, soa + 5 * num_rays, soa + 6 * num_rays, num_rays,
+      hits);
+  printf(" * tris   : %8.2f ms (%u hits)\n", bench_now_ms() - t0, num_hits);
+
+  GridTr_free(hits);
+  GridTr_free(soa);
+  GridTr_destroy_grid(&grid);
+  bench_free_colliders(colls, n);
+}
+
+int main(int argc, char *args[]) {
+  bench_cell_keys();
+  bench_build();
+  bench_insert_modes();
+  bench_mgrid();
+  bench_batch();
+  bench_packets();
+  GridTr_prmemstats();
+  return 0;
+}
@@ -0,0 +1,6 @@
+#!/bin/bash
+
+echo "compiling bench..."
+gcc -std=c11 -O2 bench.c defs.c vec.c array.c hash.c geom.c collide.c grid.c query.c mgrid.c pool.c packet.c export.c -o bench.exe -lm -pthread
+echo "done!"
+./bench.exe
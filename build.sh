@@ -16,6 +16,10 @@ SRCS=(
   "$ROOT/vec.c"
   "$ROOT/hash.c"
   "$ROOT/grid.c"
+  "$ROOT/query.c"
+  "$ROOT/mgrid.c"
+  "$ROOT/pool.c"
+  "$ROOT/packet.c"
   "$ROOT/geom.c"
   "$ROOT/export.c"
   "$ROOT/defs.c"
@@ -65,18 +65,14 @@ void GridTr_collider_dtor(void *ptr) {
   GridTr_destroy_collider((struct GridTr_collider_s *)ptr);
 }
 
-void GridTr_create_collider(struct GridTr_collider_s *collider, uint32 id,
-                            const struct vec3_s *ps, uint32 nps,
-                            struct GridTr_plane_s plane) {
-  if (!collider || !ps || nps < 3)
-    return;
+// fills a collider whose arrays are set up already
+static void GridTr_collider_init(struct GridTr_collider_s *collider, uint32 id,
+                                 const struct vec3_s *ps, uint32 nps,
+                                 struct GridTr_plane_s plane) {
   // printf("<%s>\n", __FUNCTION__);
   collider->poly_id = id;
   collider->plane = plane;
   collider->edge_count = nps;
-  collider->ps = GridTr_new(nps * sizeof(struct vec3_s));
-  collider->es = GridTr_new(nps * sizeof(struct vec3_s));
-  collider->edge_planes = GridTr_new(nps * sizeof(struct GridTr_plane_s));
   collider->o = ps[0];
   for (uint i = 1; i < nps; i++) {
     collider->o = vec3_add(collider->o, ps[i]);
@@ -85,7 +81,6 @@ void GridTr_create_collider(struct GridTr_collider_s *collider, uint32 id,
   // printf(" * plane detail: n=<%f, %f, %f> dist=%f\n", collider->plane.n.x,
   //        collider->plane.n.y, collider->plane.n.z, collider->plane.dist);
 
-  collider->edge_lens = GridTr_new(nps * sizeof(float));
   for (uint i = 0; i < nps; i++) {
     collider->ps[i] = ps[i];
     collider->es[i] = point_vec(ps[i], ps[(i + 1) % nps]);
@@ -118,8 +113,112 @@ void GridTr_create_collider(struct GridTr_collider_s *collider, uint32 id,
   // printf("---\n");
 }
 
+void GridTr_create_collider(struct GridTr_collider_s *collider, uint32 id,
+                            const struct vec3_s *ps, uint32 nps,
+                            struct GridTr_plane_s plane) {
+  if (!collider || !ps || nps < 3)
+    return;
+  collider->ps = GridTr_new(nps * sizeof(struct vec3_s));
+  collider->es = GridTr_new(nps * sizeof(struct vec3_s));
+  collider->edge_planes = GridTr_new(nps * sizeof(struct GridTr_plane_s));
+  collider->edge_lens = GridTr_new(nps * sizeof(float));
+  collider->pooled = false;
+  GridTr_collider_init(collider, id, ps, nps, plane);
+}
+
+void GridTr_create_collider_pool(struct GridTr_collider_pool_s *pool,
+                                 uint32 max_edges) {
+  if (!pool)
+    return;
+  pool->ps = pool->es = NULL;
+  pool->edge_planes = NULL;
+  pool->edge_lens = NULL;
+  if (max_edges) {
+    pool->ps = GridTr_new(max_edges * sizeof(struct vec3_s));
+    pool->es = GridTr_new(max_edges * sizeof(struct vec3_s));
+    pool->edge_planes = GridTr_new(max_edges * sizeof(struct GridTr_plane_s));
+    pool->edge_lens = GridTr_new(max_edges * sizeof(float));
+  }
+  pool->num_edges = 0;
+  pool->max_edges = max_edges;
+}
+
+void GridTr_destroy_collider_pool(struct GridTr_collider_pool_s *pool) {
+  if (!pool)
+    return;
+  GridTr_free(pool->ps);
+  GridTr_free(pool->es);
+  GridTr_free(pool->edge_planes);
+  GridTr_free(pool->edge_lens);
+  pool->num_edges = pool->max_edges = 0;
+}
+
+// points the collider at its edges in pool
+static void GridTr_collider_pool_point(struct GridTr_collider_pool_s *pool,
+                                       struct GridTr_collider_s *collider,
+                                       uint32 offset) {
+  collider->pooled = true;
+  collider->pool_offset = offset;
+  collider->ps = pool->ps + offset;
+  collider->es = pool->es + offset;
+  collider->edge_planes = pool->edge_planes + offset;
+  collider->edge_lens = pool->edge_lens + offset;
+}
+
+static bool GridTr_collider_pool_take(struct GridTr_collider_pool_s *pool,
+                                      struct GridTr_collider_s *collider,
+                                      uint32 num_edges) {
+  if (pool->num_edges + num_edges > pool->max_edges) {
+    printf("<%s> - pool is full (%u + %u edges of %u)\n", __FUNCTION__,
+           pool->num_edges, num_edges, pool->max_edges);
+    return false;
+  }
+  GridTr_collider_pool_point(pool, collider, pool->num_edges);
+  pool->num_edges += num_edges;
+  return true;
+}
+
+void GridTr_collider_pool_reserve(struct GridTr_collider_pool_s *pool,
+                                  struct GridTr_collider_s *colliders,
+                                  uint32 num_colliders, uint32 num_edges) {
+  if (!pool || pool->num_edges + num_edges <= pool->max_edges)
+    return;
+  uint32 live = 0;
+  for (uint32 i = 0; i < num_colliders; i++)
+    live += colliders[i].pooled ? colliders[i].edge_count : 0;
+  // half again as much as is live, so a run of single adds stays amortized
+  struct GridTr_collider_pool_s old = *pool;
+  GridTr_create_collider_pool(pool, live + num_edges + live / 2);
+  for (uint32 i = 0; i < num_colliders; i++) {
+    struct GridTr_collider_s *collider = &colliders[i];
+    if (!collider->pooled)
+      continue;
+    uint32 from = collider->pool_offset, n = collider->edge_count;
+    memcpy(pool->ps + pool->num_edges, old.ps + from, n * sizeof(*old.ps));
+    memcpy(pool->es + pool->num_edges, old.es + from, n * sizeof(*old.es));
+    memcpy(pool->edge_planes + pool->num_edges, old.edge_planes + from,
+           n * sizeof(*old.edge_planes));
+    memcpy(pool->edge_lens + pool->num_edges, old.edge_lens + from,
+           n * sizeof(*old.edge_lens));
+    GridTr_collider_pool_point(pool, collider, pool->num_edges);
+    pool->num_edges += n;
+  }
+  GridTr_destroy_collider_pool(&old);
+}
+
+bool GridTr_create_collider_pooled(struct GridTr_collider_pool_s *pool,
+                                   struct GridTr_collider_s *collider,
+                                   uint32 id, const struct vec3_s *ps,
+                                   uint32 nps, struct GridTr_plane_s plane) {
+  if (!pool || !collider || !ps || nps < 3 ||
+      !GridTr_collider_pool_take(pool, collider, nps))
+    return false;
+  GridTr_collider_init(collider, id, ps, nps, plane);
+  return true;
+}
+
 void GridTr_destroy_collider(struct GridTr_collider_s *collider) {
-  if (!collider)
+  if (!collider || collider->pooled)
     return;
   GridTr_free(collider->ps);
   GridTr_free(collider->es);
@@ -128,21 +227,15 @@ void GridTr_destroy_collider(struct GridTr_collider_s *collider) {
   // memset(collider, 0, sizeof(struct GridTr_collider_s));
 }
 
-void GridTr_copy_collider(struct GridTr_collider_s *to,
-                          const struct GridTr_collider_s *from) {
-  if (to == NULL || from == NULL)
-    return;
+// everything but the array pointers, which have to be set up already
+static void GridTr_collider_copy_to(struct GridTr_collider_s *to,
+                                    const struct GridTr_collider_s *from) {
   // printf("<%s>\n", __FUNCTION__);
   to->poly_id = from->poly_id;
   to->plane = from->plane;
   to->o = from->o;
   to->radius = from->radius;
   to->edge_count = from->edge_count;
-  to->ps = GridTr_new(from->edge_count * sizeof(struct vec3_s));
-  to->es = GridTr_new(from->edge_count * sizeof(struct vec3_s));
-  to->edge_lens = GridTr_new(from->edge_count * sizeof(float));
-  to->edge_planes =
-      GridTr_new(from->edge_count * sizeof(struct GridTr_plane_s));
   for (uint i = 0; i < from->edge_count; i++) {
     to->ps[i] = from->ps[i];
     to->es[i] = from->es[i];
@@ -155,25 +248,43 @@ void GridTr_copy_collider(struct GridTr_collider_s *to,
   // printf("---\n");
 }
 
+void GridTr_copy_collider(struct GridTr_collider_s *to,
+                          const struct GridTr_collider_s *from) {
+  if (to == NULL || from == NULL)
+    return;
+  to->ps = GridTr_new(from->edge_count * sizeof(struct vec3_s));
+  to->es = GridTr_new(from->edge_count * sizeof(struct vec3_s));
+  to->edge_lens = GridTr_new(from->edge_count * sizeof(float));
+  to->edge_planes =
+      GridTr_new(from->edge_count * sizeof(struct GridTr_plane_s));
+  to->pooled = false;
+  GridTr_collider_copy_to(to, from);
+}
+
+bool GridTr_copy_collider_pooled(struct GridTr_collider_pool_s *pool,
+                                 struct GridTr_collider_s *to,
+                                 const struct GridTr_collider_s *from) {
+  if (!pool || !to || !from ||
+      !GridTr_collider_pool_take(pool, to, from->edge_count))
+    return false;
+  GridTr_collider_copy_to(to, from);
+  return true;
+}
+
 bool GridTr_collider_touches_aabb(const struct GridTr_collider_s *collider,
                                   const struct GridTr_aabb_s *aabb) {
   struct vec3_s axes[3] = {
       {1.0f, 0.0f, 0.0f}, {0.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 1.0f}};
+  return GridTr_collider_touches_obb(collider, aabb->o, axes, aabb->halfsize);
+}
 
-  struct vec3_s aabb_ps[8];
-  struct vec3_s size = vec3_mul(aabb->halfsize, 2.0f);
-  // aabb_ps[0] = aabb->min;
-  // aabb_ps[1] = vec3_add(aabb->min, vec3_set(size.x, 0, 0));
-  // aabb_ps[2] = vec3_add(aabb->min, vec3_set(0, size.y, 0));
-  // aabb_ps[3] = vec3_add(aabb->min, vec3_set(size.x, size.y, 0));
-  // aabb_ps[4] = vec3_add(aabb->min, vec3_set(0, 0, size.z));
-  // aabb_ps[5] = vec3_add(aabb->min, vec3_set(size.x, 0, size.z));
-  // aabb_ps[6] = vec3_add(aabb->min, vec3_set(0, size.y, size.z));
-  // aabb_ps[7] = vec3_add(aabb->min, vec3_set(size.x, size.y, size.z));
+bool GridTr_collider_touches_obb(const struct GridTr_collider_s *collider,
+                                 struct vec3_s o, const struct vec3_s *axes,
+                                 struct vec3_s half_size) {
   struct GridTr_sat_s sat;
 #define TEST_SAT                                                               \
   do {                                                                         \
-    GridTr_sat_setas(&sat, aabb->o, axes, aabb->halfsize, true);               \
+    GridTr_sat_setas(&sat, o, axes, half_size, true);                          \
     GridTr_sat_setps(&sat, collider->ps, collider->edge_count, false);         \
     if (!GridTr_sat_olap(&sat))                                                \
       return false;                                                            \
@@ -206,9 +317,307 @@ bool GridTr_collider_touches_aabb(const struct GridTr_collider_s *collider,
   return true;
 }
 
-bool GridTr_load_colliders_from_obj(struct GridTr_collider_s **colliders,
-                                    uint32 *num_colliders,
-                                    const char *filename) {
+static void GridTr_collider_sat_add(struct GridTr_collider_sat_s *sat,
+                                    const struct GridTr_collider_s *collider,
+                                    struct vec3_s d) {
+  struct GridTr_sat_s proj;
+  proj.d = d;
+  GridTr_sat_setps(&proj, collider->ps, collider->edge_count, false);
+  uint32 i = sat->num_axes++;
+  sat->dx[i] = d.x;
+  sat->dy[i] = d.y;
+  sat->dz[i] = d.z;
+  sat->ax[i] = fabsf(d.x);
+  sat->ay[i] = fabsf(d.y);
+  sat->az[i] = fabsf(d.z);
+  sat->lo[i] = proj.min_maxs[1].x - TOL;
+  sat->hi[i] = proj.min_maxs[1].y;
+}
+
+bool GridTr_collider_sat_init(struct GridTr_collider_sat_s *sat,
+                              const struct GridTr_collider_s *collider) {
+  if (!sat || !collider ||
+      (collider->edge_count != 3 && collider->edge_count != 4))
+    return false;
+  // same axes, computed the same way, as GridTr_collider_touches_obb()
+  struct vec3_s axes[3] = {
+      {{{1.0f, 0.0f, 0.0f}}}, {{{0.0f, 1.0f, 0.0f}}}, {{{0.0f, 0.0f, 1.0f}}}};
+  sat->num_axes = 0;
+  for (int i = 0; i < 3; i++)
+    GridTr_collider_sat_add(sat, collider, axes[i]);
+  GridTr_collider_sat_add(sat, collider, collider->plane.n);
+  for (uint32 j = 0; j < collider->edge_count; j++)
+    GridTr_collider_sat_add(sat, collider, collider->edge_planes[j].n);
+  for (int i = 0; i < 3; i++) {
+    for (uint32 j = 0; j < collider->edge_count; j++) {
+      struct vec3_s d = vec3_cross(axes[i], collider->es[j]);
+      if (vec3_lensq(d) >= TOL_SQ)
+        GridTr_collider_sat_add(sat, collider, vec3_norm(d));
+    }
+  }
+  // a zero axis puts box and polygon at 0, which always overlaps
+  while (sat->num_axes % GridTr_SIMD_WIDTH)
+    GridTr_collider_sat_add(sat, collider, vec3_zero());
+  return true;
+}
+
+bool GridTr_collider_sat_touches_aabb(const struct GridTr_collider_sat_s *sat,
+                                      const struct GridTr_aabb_s *aabb) {
+  GridTr_vf ox = GridTr_vf_set1(aabb->o.x);
+  GridTr_vf oy = GridTr_vf_set1(aabb->o.y);
+  GridTr_vf oz = GridTr_vf_set1(aabb->o.z);
+  GridTr_vf hx = GridTr_vf_set1(aabb->halfsize.x);
+  GridTr_vf hy = GridTr_vf_set1(aabb->halfsize.y);
+  GridTr_vf hz = GridTr_vf_set1(aabb->halfsize.z);
+  GridTr_vf tol = GridTr_vf_set1(TOL);
+  for (uint32 i = 0; i < sat->num_axes; i += GridTr_SIMD_WIDTH) {
+    // the box axes are unit, so GridTr_sat_setas() reduces to |d| . h
+    GridTr_vf m = GridTr_vf_dot3(ox, oy, oz, GridTr_vf_load(sat->dx + i),
+                                 GridTr_vf_load(sat->dy + i),
+                                 GridTr_vf_load(sat->dz + i));
+    GridTr_vf r = GridTr_vf_dot3(GridTr_vf_load(sat->ax + i),
+                                 GridTr_vf_load(sat->ay + i),
+                                 GridTr_vf_load(sat->az + i), hx, hy, hz);
+    // GridTr_sat_olap() with the box first
+    GridTr_vf apart =
+        GridTr_vf_or(GridTr_vf_lt(GridTr_vf_add(m, r),
+                                  GridTr_vf_load(sat->lo + i)),
+                     GridTr_vf_lt(GridTr_vf_load(sat->hi + i),
+                                  GridTr_vf_sub(GridTr_vf_sub(m, r), tol)));
+    if (GridTr_vf_movemask(apart))
+      return false;
+  }
+  return true;
+}
+
+bool GridTr_aabb_touches_obb(const struct GridTr_aabb_s *aabb,
+                             struct vec3_s o, const struct vec3_s *axes,
+                             struct vec3_s half_size) {
+  struct vec3_s aabb_axes[3] = {
+      {{{1.0f, 0.0f, 0.0f}}}, {{{0.0f, 1.0f, 0.0f}}}, {{{0.0f, 0.0f, 1.0f}}}};
+  struct GridTr_sat_s sat;
+#define TEST_SAT                                                               \
+  do {                                                                         \
+    GridTr_sat_setas(&sat, o, axes, half_size, true);                          \
+    GridTr_sat_setas(&sat, aabb->o, aabb_axes, aabb->halfsize, false);         \
+    if (!GridTr_sat_olap(&sat))                                                \
+      return false;                                                            \
+  } while (0)
+
+  for (int i = 0; i < 3; i++) {
+    sat.d = aabb_axes[i];
+    TEST_SAT;
+    sat.d = axes[i];
+    TEST_SAT;
+  }
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 3; j++) {
+      sat.d = vec3_cross(aabb_axes[i], axes[j]);
+      if (vec3_lensq(sat.d) >= TOL_SQ) {
+        sat.d = vec3_norm(sat.d);
+        TEST_SAT;
+      }
+    }
+  }
+#undef TEST_SAT
+
+  return true;
+}
+
+bool GridTr_collider_touches_frustum(const struct GridTr_collider_s *collider,
+                                     const struct GridTr_frustum_s *frustum) {
+  struct GridTr_sat_s sat;
+#define TEST_SAT                                                               \
+  do {                                                                         \
+    GridTr_sat_setps(&sat, frustum->ps, 8, true);                              \
+    GridTr_sat_setps(&sat, collider->ps, collider->edge_count, false);         \
+    if (!GridTr_sat_olap(&sat))                                                \
+      return false;                                                            \
+  } while (0)
+
+  // the planes on their own reject most of what's outside
+  for (int i = 0; i < GridTr_FRUSTUM_NUM_PLANES; i++) {
+    uint32 j = 0;
+    while (j < collider->edge_count &&
+           eval_plane(frustum->planes[i], collider->ps[j]) < -TOL)
+      j++;
+    if (j == collider->edge_count)
+      return false;
+  }
+
+  sat.d = collider->plane.n;
+  TEST_SAT;
+
+  // frustum edges: the corners one index bit apart
+  for (int i = 0; i < 8; i++) {
+    for (int b = 1; b < 8; b <<= 1) {
+      if (i & b)
+        continue;
+      struct vec3_s e = point_vec(frustum->ps[i], frustum->ps[i | b]);
+      for (uint32 j = 0; j < collider->edge_count; j++) {
+        sat.d = vec3_cross(e, collider->es[j]);
+        if (vec3_lensq(sat.d) >= TOL_SQ) {
+          sat.d = vec3_norm(sat.d);
+          TEST_SAT;
+        }
+      }
+    }
+  }
+#undef TEST_SAT
+
+  return true;
+}
+
+bool GridTr_rayseg_isect_collider(const struct GridTr_collider_s *collider,
+                                  const struct GridTr_rayseg_s *seg, float *t) {
+  float denom = vec3_dot(seg->d, collider->plane.n);
+  if (fabsf(denom) < TOL)
+    return false; // parallel (or degenerate collider)
+
+  float t_ = (collider->plane.dist - vec3_dot(seg->o, collider->plane.n)) / denom;
+  if (t_ < 0.0f || t_ > seg->len)
+    return false;
+
+  struct vec3_s p = vec3_add(seg->o, vec3_mul(seg->d, t_));
+  for (uint32 i = 0; i < collider->edge_count; i++) {
+    if (eval_plane(collider->edge_planes[i], p) > TOL)
+      return false;
+  }
+  if (t) {
+    *t = t_;
+  }
+  return true;
+}
+
+bool GridTr_rayseg_crosses_collider(const struct GridTr_collider_s *collider,
+                                    const struct GridTr_rayseg_s *seg) {
+  // a plane sign test of its own would threshold |d0 - d1|, which shrinks
+  // with the segment, and disagree with the closest hit on short grazing
+  // segments. share the ray test so occlusion and hits always agree
+  return GridTr_rayseg_isect_collider(collider, seg, NULL);
+}
+
+static bool GridTr_collider_contains(const struct GridTr_collider_s *collider,
+                                     struct vec3_s p) {
+  for (uint32 i = 0; i < collider->edge_count; i++) {
+    if (eval_plane(collider->edge_planes[i], p) > TOL)
+      return false;
+  }
+  return true;
+}
+
+bool GridTr_sweep_sphere_collider(const struct GridTr_collider_s *collider,
+                                  const struct GridTr_rayseg_s *seg,
+                                  float radius, float *t, struct vec3_s *n) {
+  // face: the sphere first touches the plane at distance radius, which is
+  // the earliest contact possible if that touch point is inside
+  struct GridTr_sphere_s sphere = {seg->o, radius};
+  struct vec3_s touch_p;
+  float d0 = eval_plane(collider->plane, seg->o);
+  float side = d0 >= 0.0f ? 1.0f : -1.0f;
+  if (GridTr_sphere_touches_plane(&sphere, &collider->plane, &touch_p)) {
+    if (GridTr_collider_contains(collider, touch_p)) {
+      *t = 0.0f;
+      *n = vec3_mul(collider->plane.n, side);
+      return true;
+    }
+  } else {
+    float denom = vec3_dot(seg->d, collider->plane.n);
+    if (denom * side >= -TOL)
+      return false; // clear of the plane and not closing in
+    float t_ = (side * radius - d0) / denom;
+    if (t_ > seg->len)
+      return false; // edges and vertices can't be reached any sooner
+    struct vec3_s c = vec3_add(seg->o, vec3_mul(seg->d, t_));
+    struct vec3_s p = vec3_sub(c, vec3_mul(collider->plane.n, side * radius));
+    if (GridTr_collider_contains(collider, p)) {
+      *t = t_;
+      *n = vec3_mul(collider->plane.n, side);
+      return true;
+    }
+  }
+
+  float best_t = FLT_MAX;
+  struct vec3_s best_p = vec3_zero();
+  float r_sq = SQ(radius);
+  for (uint32 i = 0; i < collider->edge_count; i++) {
+    // edge cylinder, only counts between the edge's end points
+    float len = collider->edge_lens[i];
+    if (len > 0.0f) {
+      struct vec3_s e = collider->es[i];
+      struct vec3_s m = point_vec(collider->ps[i], seg->o);
+      struct vec3_s dd = vec3_sub(seg->d, vec3_mul(e, vec3_dot(seg->d, e)));
+      struct vec3_s mm = vec3_sub(m, vec3_mul(e, vec3_dot(m, e)));
+      float a = vec3_dot(dd, dd);
+      float b = vec3_dot(mm, dd);
+      float c = vec3_dot(mm, mm) - r_sq;
+      float t_ = -1.0f;
+      if (c <= 0.0f) {
+        t_ = 0.0f;
+      } else if (a > TOL && b < 0.0f && SQ(b) - a * c >= 0.0f) {
+        t_ = (-b - sqrtf(SQ(b) - a * c)) / a;
+      }
+      if (t_ >= 0.0f && t_ <= seg->len && t_ < best_t) {
+        float s = vec3_dot(vec3_add(m, vec3_mul(seg->d, t_)), e);
+        if (s >= 0.0f && s <= len) {
+          best_t = t_;
+          best_p = vec3_add(collider->ps[i], vec3_mul(e, s));
+        }
+      }
+    }
+    // vertex sphere
+    struct GridTr_sphere_s vs = {collider->ps[i], radius};
+    float ts[2];
+    uint num_ts =
+        seg->len > 0.0f ? GridTr_ray_isect_sphere(&seg->ray, &vs, ts) : 0;
+    float t_ = -1.0f;
+    if (vec3_lensq(point_vec(vs.c, seg->o)) <= r_sq)
+      t_ = 0.0f;
+    else if (num_ts && ts[0] >= 0.0f)
+      t_ = ts[0];
+    if (t_ >= 0.0f && t_ <= seg->len && t_ < best_t) {
+      best_t = t_;
+      best_p = collider->ps[i];
+    }
+  }
+  if (best_t == FLT_MAX)
+    return false;
+  *t = best_t;
+  struct vec3_s c = vec3_add(seg->o, vec3_mul(seg->d, best_t));
+  struct vec3_s v = point_vec(best_p, c);
+  *n = vec3_lensq(v) > TOL_SQ ? vec3_norm(v) : vec3_mul(seg->d, -1.0f);
+  return true;
+}
+
+struct vec3_s
+GridTr_collider_closest_point(const struct GridTr_collider_s *collider,
+                              struct vec3_s p) {
+  // inside the polygon's prism the projection onto the plane is it
+  struct vec3_s q =
+      vec3_sub(p, vec3_mul(collider->plane.n, eval_plane(collider->plane, p)));
+  if (GridTr_collider_contains(collider, q))
+    return q;
+  // otherwise it's on the boundary
+  float best_d_sq = FLT_MAX;
+  for (uint32 i = 0; i < collider->edge_count; i++) {
+    float s = CLAMP(vec3_dot(point_vec(collider->ps[i], p), collider->es[i]),
+                    0.0f, collider->edge_lens[i]);
+    struct vec3_s c = vec3_add(collider->ps[i], vec3_mul(collider->es[i], s));
+    float d_sq = vec3_lensq(point_vec(c, p));
+    if (d_sq < best_d_sq) {
+      best_d_sq = d_sq;
+      q = c;
+    }
+  }
+  return q;
+}
+
+// pool NULL gives every collider its own arrays
+static bool
+GridTr_load_colliders_from_obj_(struct GridTr_collider_s **colliders,
+                                uint32 *num_colliders,
+                                struct GridTr_collider_pool_s *pool,
+                                const char *filename) {
   if (!colliders || !num_colliders || !filename) {
     printf("<%s> - missing parameter(s) (file '%s')\n", __FUNCTION__, filename);
     return false;
@@ -224,6 +633,7 @@ bool GridTr_load_colliders_from_obj(struct GridTr_collider_s **colliders,
 
   uint32 num_vs = 0;
   uint32 num_fs = 0;
+  uint32 num_edges = 0; // upper bound, face vertices are counted as tokens
   char line[256];
   while (fgets(line, sizeof(line), fp)) {
     // Parse the line and extract vertex/face information
@@ -231,9 +641,19 @@ bool GridTr_load_colliders_from_obj(struct GridTr_collider_s **colliders,
       ++num_vs;
     } else if (line[0] == 'f' && line[1] == ' ') {
       ++num_fs;
+      uint32 num_tokens = 0;
+      bool in_token = false;
+      for (char *p = line + 2; *p; p++) {
+        bool sep = *p == ' ' || *p == '\n';
+        num_tokens += !sep && !in_token;
+        in_token = !sep;
+      }
+      num_edges += MIN(num_tokens, 8);
     }
   }
   fseek(fp, 0, SEEK_SET);
+  if (pool)
+    GridTr_create_collider_pool(pool, num_edges);
 
   struct vec3_s *vs = GridTr_new(sizeof(struct vec3_s) * num_vs);
   *colliders = GridTr_new(sizeof(struct GridTr_collider_s) * num_fs);
@@ -276,7 +696,10 @@ bool GridTr_load_colliders_from_obj(struct GridTr_collider_s **colliders,
       v = point_vec(ps[0], ps[2]);
       struct GridTr_plane_s plane =
           GridTr_create_plane(vec3_cross(u, v), ps[0]);
-      GridTr_create_collider(collider, i, ps, num_ps, plane);
+      if (pool)
+        GridTr_create_collider_pooled(pool, collider, i, ps, num_ps, plane);
+      else
+        GridTr_create_collider(collider, i, ps, num_ps, plane);
       // printf(" * collider %d: %d edges | plane: <%.4f, %.4f, %.4f | %.4f>\n",
       // i,
       //        collider->edge_count, plane.n.x, plane.n.y, plane.n.z,
@@ -289,4 +712,23 @@ bool GridTr_load_colliders_from_obj(struct GridTr_collider_s **colliders,
   //        num_fs, filename);
   fclose(fp);
   return true;
+}
+
+bool GridTr_load_colliders_from_obj(struct GridTr_collider_s **colliders,
+                                    uint32 *num_colliders,
+                                    const char *filename) {
+  return GridTr_load_colliders_from_obj_(colliders, num_colliders, NULL,
+                                         filename);
+}
+
+bool GridTr_load_colliders_from_obj_pooled(
+    struct GridTr_collider_s **colliders, uint32 *num_colliders,
+    struct GridTr_collider_pool_s *pool, const char *filename) {
+  if (!pool) {
+    printf("<%s> - missing pool (file '%s')\n", __FUNCTION__, filename);
+    return false;
+  }
+  GridTr_create_collider_pool(pool, 0);
+  return GridTr_load_colliders_from_obj_(colliders, num_colliders, pool,
+                                         filename);
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "geom.h"
+#include "simd.h"
 
 struct GridTr_sat_s {
   struct vec3_s d;
@@ -29,23 +30,132 @@ struct GridTr_collider_s {
   float *edge_lens;
   struct vec3_s *ps;
   struct vec3_s *es;
+  // the arrays above are edge_count entries at pool_offset of a
+  // GridTr_collider_pool_s rather than allocations of their own
+  bool pooled;
+  uint32 pool_offset;
 };
 
+// per-edge arrays of many colliders packed back to back, one allocation
+// per array. pooled colliders point into it: it has to outlive them, and
+// GridTr_destroy_collider() leaves their arrays alone
+struct GridTr_collider_pool_s {
+  struct vec3_s *ps;
+  struct vec3_s *es;
+  struct GridTr_plane_s *edge_planes;
+  float *edge_lens;
+  uint32 num_edges;
+  uint32 max_edges;
+};
+
+void GridTr_create_collider_pool(struct GridTr_collider_pool_s *pool,
+                                 uint32 max_edges);
+void GridTr_destroy_collider_pool(struct GridTr_collider_pool_s *pool);
+
+// makes room for num_edges more edges. when the pool is full its arrays are
+// reallocated holding only the pooled colliders of colliders[0..n), packed
+// in that order and repointed, so edges of destroyed colliders get reused.
+// every collider still using the pool has to be in colliders
+void GridTr_collider_pool_reserve(struct GridTr_collider_pool_s *pool,
+                                  struct GridTr_collider_s *colliders,
+                                  uint32 num_colliders, uint32 num_edges);
+
 // assumes points are in counter-clockwise order and form a convex polygon
 void GridTr_create_collider(struct GridTr_collider_s *collider, uint32 id,
                             const struct vec3_s *ps, uint32 nps,
                             struct GridTr_plane_s plane);
 
+// GridTr_create_collider() with the arrays taken from pool, false when it
+// has no room for nps more edges
+bool GridTr_create_collider_pooled(struct GridTr_collider_pool_s *pool,
+                                   struct GridTr_collider_s *collider,
+                                   uint32 id, const struct vec3_s *ps,
+                                   uint32 nps, struct GridTr_plane_s plane);
+
 void GridTr_destroy_collider(struct GridTr_collider_s *collider);
 
 bool GridTr_collider_touches_aabb(const struct GridTr_collider_s *collider,
                                   const struct GridTr_aabb_s *aabb);
 
+// box centered at o with unit axes[3] and half extents half_size along them
+bool GridTr_collider_touches_obb(const struct GridTr_collider_s *collider,
+                                 struct vec3_s o, const struct vec3_s *axes,
+                                 struct vec3_s half_size);
+
+// 3 box + 1 face + 4 edge plane + 12 cross axes for a quad, padded to
+// whole SIMD vectors
+#define GridTr_COLLIDER_SAT_MAX_AXES 24
+
+// the axes GridTr_collider_touches_aabb() tries for a triangle or quad, with
+// the polygon already projected on them: testing a box then only costs its
+// center and radius along each axis, GridTr_SIMD_WIDTH axes at a time
+struct GridTr_collider_sat_s {
+  _Alignas(GridTr_SIMD_ALIGN) float dx[GridTr_COLLIDER_SAT_MAX_AXES];
+  _Alignas(GridTr_SIMD_ALIGN) float dy[GridTr_COLLIDER_SAT_MAX_AXES];
+  _Alignas(GridTr_SIMD_ALIGN) float dz[GridTr_COLLIDER_SAT_MAX_AXES];
+  // |d|, component by component
+  _Alignas(GridTr_SIMD_ALIGN) float ax[GridTr_COLLIDER_SAT_MAX_AXES];
+  _Alignas(GridTr_SIMD_ALIGN) float ay[GridTr_COLLIDER_SAT_MAX_AXES];
+  _Alignas(GridTr_SIMD_ALIGN) float az[GridTr_COLLIDER_SAT_MAX_AXES];
+  // polygon interval on d, lo has TOL taken off already
+  _Alignas(GridTr_SIMD_ALIGN) float lo[GridTr_COLLIDER_SAT_MAX_AXES];
+  _Alignas(GridTr_SIMD_ALIGN) float hi[GridTr_COLLIDER_SAT_MAX_AXES];
+  uint32 num_axes;
+};
+
+// false (and sat untouched) unless the collider has 3 or 4 edges
+bool GridTr_collider_sat_init(struct GridTr_collider_sat_s *sat,
+                              const struct GridTr_collider_s *collider);
+
+// same result as GridTr_collider_touches_aabb(), bit for bit
+bool GridTr_collider_sat_touches_aabb(const struct GridTr_collider_sat_s *sat,
+                                      const struct GridTr_aabb_s *aabb);
+
+bool GridTr_aabb_touches_obb(const struct GridTr_aabb_s *aabb,
+                             struct vec3_s o, const struct vec3_s *axes,
+                             struct vec3_s half_size);
+
+// exact SAT of the polygon against the frustum's volume
+bool GridTr_collider_touches_frustum(const struct GridTr_collider_s *collider,
+                                     const struct GridTr_frustum_s *frustum);
+
 void GridTr_copy_collider(struct GridTr_collider_s *to,
                           const struct GridTr_collider_s *from);
+// GridTr_copy_collider() into arrays taken from pool, false when it has no
+// room for from->edge_count more edges
+bool GridTr_copy_collider_pooled(struct GridTr_collider_pool_s *pool,
+                                 struct GridTr_collider_s *to,
+                                 const struct GridTr_collider_s *from);
 
 void GridTr_collider_dtor(void *ptr);
 
+// segment vs polygon using the precomputed plane/edge_planes, seg->d must be
+// unit length (see GridTr_create_rayseg()). polygons are double-sided
+bool GridTr_rayseg_isect_collider(const struct GridTr_collider_s *collider,
+                                  const struct GridTr_rayseg_s *seg, float *t);
+
+// boolean version of the above for occlusion tests, hits exactly when
+// GridTr_rayseg_isect_collider() does
+bool GridTr_rayseg_crosses_collider(const struct GridTr_collider_s *collider,
+                                    const struct GridTr_rayseg_s *seg);
+
+// sphere of radius moving along seg (seg->d unit length) vs polygon: face,
+// then edge cylinders, then vertex spheres. t is the earliest contact
+// (0 when already touching), n points from the contact towards the center
+bool GridTr_sweep_sphere_collider(const struct GridTr_collider_s *collider,
+                                  const struct GridTr_rayseg_s *seg,
+                                  float radius, float *t, struct vec3_s *n);
+
+// exact closest point on the (convex) polygon to p
+struct vec3_s
+GridTr_collider_closest_point(const struct GridTr_collider_s *collider,
+                              struct vec3_s p);
+
 bool GridTr_load_colliders_from_obj(struct GridTr_collider_s **colliders,
                                     uint32 *num_colliders,
-                                    const char *filename);
\ No newline at end of file
+                                    const char *filename);
+// same, with every collider's arrays in pool (created here). destroy the
+// colliders, free the array and then destroy the pool
+bool GridTr_load_colliders_from_obj_pooled(
+    struct GridTr_collider_s **colliders, uint32 *num_colliders,
+    struct GridTr_collider_pool_s *pool, const char *filename);
\ No newline at end of file
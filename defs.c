@@ -24,6 +24,63 @@ atomic_uint_fast32_t g_total_allocs = 0;
 
 static pthread_mutex_t g_alloc_lock = PTHREAD_MUTEX_INITIALIZER;
 
+/* open addressing index from address to list position + 1 (0 = empty),
+ * sized to twice the list capacity, so frees don't scan the whole list */
+static uint32 *g_alloc_index = NULL;
+static uint32 g_alloc_index_mask = 0;
+
+static uint32 alloc_index_home(uint64 addr) {
+  return (uint32)(((addr >> 4) * 0x9E3779B97F4A7C15ull) >> 32) &
+         g_alloc_index_mask;
+}
+
+static uint32 alloc_index_find(uint64 addr) {
+  for (uint32 s = alloc_index_home(addr); g_alloc_index[s];
+       s = (s + 1) & g_alloc_index_mask) {
+    if (g_alloc_list[g_alloc_index[s] - 1].addr == addr)
+      return s;
+  }
+  return UINT32_MAX;
+}
+
+static void alloc_index_insert(uint32 list_idx) {
+  uint32 s = alloc_index_home(g_alloc_list[list_idx].addr);
+  while (g_alloc_index[s])
+    s = (s + 1) & g_alloc_index_mask;
+  g_alloc_index[s] = list_idx + 1;
+}
+
+/* backward shift deletion, keeps every probe chain unbroken */
+static void alloc_index_remove(uint32 s) {
+  uint32 mask = g_alloc_index_mask;
+  for (;;) {
+    g_alloc_index[s] = 0;
+    uint32 j = s;
+    for (;;) {
+      j = (j + 1) & mask;
+      if (!g_alloc_index[j])
+        return;
+      uint32 home = alloc_index_home(g_alloc_list[g_alloc_index[j] - 1].addr);
+      /* j may fill the hole unless its home lies cyclically in (s, j] */
+      if (((j - home) & mask) >= ((j - s) & mask))
+        break;
+    }
+    g_alloc_index[s] = g_alloc_index[j];
+    s = j;
+  }
+}
+
+static void alloc_index_rebuild(void) {
+  uint32 cap = 1;
+  while (cap < g_max_allocs * 2)
+    cap <<= 1;
+  free(g_alloc_index);
+  g_alloc_index = calloc(cap, sizeof(uint32));
+  g_alloc_index_mask = cap - 1;
+  for (uint32 i = 0; i < g_num_allocs; i++)
+    alloc_index_insert(i);
+}
+
 void *GridTr_allocmem(size_t size, const char *file, int line) {
   /* update simple counters atomically */
   atomic_fetch_add(&g_total_mem, (uint32)size);
@@ -35,15 +92,17 @@ void *GridTr_allocmem(size_t size, const char *file, int line) {
   /* protect list resize and append with mutex */
   pthread_mutex_lock(&g_alloc_lock);
   if (g_num_allocs == g_max_allocs) {
-    g_max_allocs += 4096;
+    g_max_allocs += MAX(g_max_allocs, 4096);
     struct alloc_s *new_list = malloc(sizeof(struct alloc_s) * g_max_allocs);
     if (g_alloc_list) {
       memcpy(new_list, g_alloc_list, sizeof(struct alloc_s) * g_num_allocs);
       free(g_alloc_list);
     }
     g_alloc_list = new_list;
+    alloc_index_rebuild();
   }
   g_alloc_list[g_num_allocs] = (struct alloc_s){(uint64)p, size, file, line};
+  alloc_index_insert(g_num_allocs);
   g_num_allocs++;
   pthread_mutex_unlock(&g_alloc_lock);
   return p;
@@ -51,20 +110,25 @@ void *GridTr_allocmem(size_t size, const char *file, int line) {
 
 void GridTr_freemem(void *ptr) {
   pthread_mutex_lock(&g_alloc_lock);
-  for (uint i = 0; i < g_num_allocs; i++) {
-    if (g_alloc_list[i].addr == (uint64)ptr) {
-      /* adjust counter atomically, then remove entry under lock */
-      atomic_fetch_sub(&g_total_mem, (uint32)g_alloc_list[i].size);
-      g_alloc_list[i] = g_alloc_list[g_num_allocs - 1];
-      g_alloc_list[g_num_allocs - 1].addr = 0;
-      g_alloc_list[g_num_allocs - 1].size = 0;
-      g_alloc_list[g_num_allocs - 1].file = NULL;
-      g_alloc_list[g_num_allocs - 1].line = 0;
-      g_num_allocs--;
-      pthread_mutex_unlock(&g_alloc_lock);
-      free(ptr);
-      return;
+  uint32 s = g_alloc_index ? alloc_index_find((uint64)ptr) : UINT32_MAX;
+  if (s != UINT32_MAX) {
+    uint32 i = g_alloc_index[s] - 1;
+    /* adjust counter atomically, then remove entry under lock */
+    atomic_fetch_sub(&g_total_mem, (uint32)g_alloc_list[i].size);
+    alloc_index_remove(s);
+    uint32 last = g_num_allocs - 1;
+    if (i != last) {
+      g_alloc_list[i] = g_alloc_list[last];
+      g_alloc_index[alloc_index_find(g_alloc_list[i].addr)] = i + 1;
     }
+    g_alloc_list[last].addr = 0;
+    g_alloc_list[last].size = 0;
+    g_alloc_list[last].file = NULL;
+    g_alloc_list[last].line = 0;
+    g_num_allocs--;
+    pthread_mutex_unlock(&g_alloc_lock);
+    free(ptr);
+    return;
   }
   pthread_mutex_unlock(&g_alloc_lock);
   printf("freemem: untracked pointer or double-free\n", ptr);
@@ -1,5 +1,6 @@
 #pragma once
 #include <float.h>
+#include <stddef.h>
 #include <stdbool.h>
 #include <stdint.h>
 
@@ -207,4 +207,38 @@ bool GridTr_aabb_touches_aabb(const struct GridTr_aabb_s *aabb0,
   if (aabb0->max.z < aabb1->min.z || aabb0->min.z > aabb1->max.z)
     return false;
   return true;
-}
\ No newline at end of file
+}
+
+bool GridTr_frustum_init(struct GridTr_frustum_s *frustum,
+                         const struct GridTr_plane_s *planes) {
+  for (int i = 0; i < GridTr_FRUSTUM_NUM_PLANES; i++)
+    frustum->planes[i] = planes[i];
+  for (int i = 0; i < 8; i++) {
+    struct GridTr_plane_s p0 = planes[GridTr_FRUSTUM_LEFT + (i & 1)];
+    struct GridTr_plane_s p1 = planes[GridTr_FRUSTUM_BOTTOM + ((i >> 1) & 1)];
+    struct GridTr_plane_s p2 = planes[GridTr_FRUSTUM_NEAR + ((i >> 2) & 1)];
+    struct vec3_s c12 = vec3_cross(p1.n, p2.n);
+    float denom = vec3_dot(p0.n, c12);
+    if (fabsf(denom) < TOL)
+      return false;
+    struct vec3_s p = vec3_mul(c12, p0.dist);
+    p = vec3_add(p, vec3_mul(vec3_cross(p2.n, p0.n), p1.dist));
+    p = vec3_add(p, vec3_mul(vec3_cross(p0.n, p1.n), p2.dist));
+    frustum->ps[i] = vec3_mul(p, 1.0f / denom);
+  }
+  return true;
+}
+
+bool GridTr_frustum_culls_aabb(const struct GridTr_frustum_s *frustum,
+                               const struct GridTr_aabb_s *aabb) {
+  for (int i = 0; i < GridTr_FRUSTUM_NUM_PLANES; i++) {
+    // the corner furthest along the normal, if that's behind so is the box
+    struct GridTr_plane_s pl = frustum->planes[i];
+    struct vec3_s p = vec3_set(pl.n.x >= 0.0f ? aabb->max.x : aabb->min.x,
+                               pl.n.y >= 0.0f ? aabb->max.y : aabb->min.y,
+                               pl.n.z >= 0.0f ? aabb->max.z : aabb->min.z);
+    if (eval_plane(pl, p) < -TOL)
+      return true;
+  }
+  return false;
+}
@@ -76,4 +76,31 @@ bool GridTr_aabb_clip_ray(const struct GridTr_aabb_s *aabb,
                           const struct GridTr_ray_s *ray, float *ts);
 
 bool GridTr_aabb_touches_aabb(const struct GridTr_aabb_s *aabb0,
-                              const struct GridTr_aabb_s *aabb1);
\ No newline at end of file
+                              const struct GridTr_aabb_s *aabb1);
+
+// convex view volume: planes face inwards (eval_plane() >= 0 inside) and
+// come in GridTr_FRUSTUM_* order, ps are the corners where they meet (bit 0
+// right, bit 1 top, bit 2 far)
+enum GridTr_frustum_plane_e {
+  GridTr_FRUSTUM_LEFT = 0,
+  GridTr_FRUSTUM_RIGHT,
+  GridTr_FRUSTUM_BOTTOM,
+  GridTr_FRUSTUM_TOP,
+  GridTr_FRUSTUM_NEAR,
+  GridTr_FRUSTUM_FAR,
+  GridTr_FRUSTUM_NUM_PLANES
+};
+
+struct GridTr_frustum_s {
+  struct GridTr_plane_s planes[GridTr_FRUSTUM_NUM_PLANES];
+  struct vec3_s ps[8];
+};
+
+// returns false if three of the planes don't meet in a corner
+bool GridTr_frustum_init(struct GridTr_frustum_s *frustum,
+                         const struct GridTr_plane_s *planes);
+
+// true if aabb is entirely behind one of the planes. cheap but loose: boxes
+// near the frustum's edges can pass without touching it
+bool GridTr_frustum_culls_aabb(const struct GridTr_frustum_s *frustum,
+                               const struct GridTr_aabb_s *aabb);
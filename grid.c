@@ -1,14 +1,20 @@
 #include "grid.h"
+#include "pool.h"
 #include "vec.inl"
 
 #include <math.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 extern bool GridTr_debug_enabled();
 
 #define TIE_EPS(t) (TOL * (1.0f + (t)))
 
+static inline bool iv3eq_(struct ivec3_s a, struct ivec3_s b) {
+  return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
 static void GridTr_grid_cell_add_collider_idx(struct GridTr_grid_cell_s *cell,
                                               uint32 collider_idx) {
   if (!cell)
@@ -26,6 +32,101 @@ void GridTr_grid_cell_dtor(void *ptr) {
   GridTr_free(cell); // this is to free the cell itself
 }
 
+void GridTr_grid_occ_dtor(void *ptr) { GridTr_free(ptr); }
+
+// floor(x / 2^s) without relying on signed right shifts
+#define FLOOR_SHR(x, s) ((x) >= 0 ? (x) >> (s) : ~((~(x)) >> (s)))
+// bit of a 4x4x4 block member inside the block's mask
+#define OCC_BIT(v)                                                             \
+  (1ull << (((uint)(v).x & 3u) | (((uint)(v).y & 3u) << 2) |                  \
+            (((uint)(v).z & 3u) << 4)))
+
+static struct ivec3_s GridTr_shr_crl(struct ivec3_s crl, int shift) {
+  return ivec3_set(FLOOR_SHR(crl.x, shift), FLOOR_SHR(crl.y, shift),
+                   FLOOR_SHR(crl.z, shift));
+}
+
+static uint64
+GridTr_grid_occ_mask(const struct GridTr_hash_table_s *table,
+                     struct ivec3_s crl) {
+  const struct GridTr_grid_occ_s *occ =
+      GridTr_hash_table_maybe_get_ro(table, ivec3_fnv1a(crl));
+  return occ ? occ->mask : 0;
+}
+
+static void GridTr_grid_occ_set(struct GridTr_hash_table_s *table,
+                                struct ivec3_s crl, uint64 bit) {
+  struct GridTr_grid_occ_s **occ =
+      (struct GridTr_grid_occ_s **)GridTr_hash_table_add_or_get(
+          table, ivec3_fnv1a(crl));
+  if (!occ)
+    return;
+  if (!*occ) {
+    *occ = GridTr_new(sizeof(struct GridTr_grid_occ_s));
+    (*occ)->crl = crl;
+    (*occ)->mask = 0;
+  }
+  (*occ)->mask |= bit;
+}
+
+// clears bit, dropping the entry once its mask is empty. returns true then
+static bool GridTr_grid_occ_clear(struct GridTr_hash_table_s *table,
+                                  struct ivec3_s crl, uint64 bit) {
+  uint64 key = ivec3_fnv1a(crl);
+  struct GridTr_grid_occ_s **occ =
+      (struct GridTr_grid_occ_s **)GridTr_hash_table_maybe_get(table, key);
+  if (!occ || !*occ)
+    return false;
+  (*occ)->mask &= ~bit;
+  if ((*occ)->mask)
+    return false;
+  GridTr_hash_table_free(table, key);
+  return true;
+}
+
+static void GridTr_grid_mark_empty(struct GridTr_grid_s *grid,
+                                   struct ivec3_s crl) {
+  struct ivec3_s brick = GridTr_shr_crl(crl, GridTr_BRICK_SHIFT);
+  if (GridTr_grid_occ_clear(grid->brick_table, brick, OCC_BIT(crl)))
+    GridTr_grid_occ_clear(grid->macro_table, GridTr_shr_crl(brick, 2),
+                          OCC_BIT(brick));
+  if (!grid->macro_table->total_elems) {
+    grid->occ_min = ivec3_set(INT32_MAX, INT32_MAX, INT32_MAX);
+    grid->occ_max = ivec3_set(INT32_MIN, INT32_MIN, INT32_MIN);
+  }
+}
+
+static void GridTr_grid_mark_occupied(struct GridTr_grid_s *grid,
+                                      struct ivec3_s crl) {
+  struct ivec3_s brick = GridTr_shr_crl(crl, GridTr_BRICK_SHIFT);
+  GridTr_grid_occ_set(grid->brick_table, brick, OCC_BIT(crl));
+  GridTr_grid_occ_set(grid->macro_table, GridTr_shr_crl(brick, 2),
+                      OCC_BIT(brick));
+  grid->occ_min = ivec3_min(grid->occ_min, crl);
+  grid->occ_max = ivec3_max(grid->occ_max, crl);
+}
+
+// index into dense_cells, or -1 if crl is outside the dense bounds
+static inline int64 GridTr_grid_dense_idx(const struct GridTr_grid_s *grid,
+                                          struct ivec3_s crl) {
+  uint x = (uint)(crl.x - grid->dense_min.x);
+  uint y = (uint)(crl.y - grid->dense_min.y);
+  uint z = (uint)(crl.z - grid->dense_min.z);
+  if (!grid->dense_cells || x >= (uint)grid->dense_dims.x ||
+      y >= (uint)grid->dense_dims.y || z >= (uint)grid->dense_dims.z)
+    return -1;
+  return (int64)x + (int64)grid->dense_dims.x *
+                        ((int64)y + (int64)grid->dense_dims.y * (int64)z);
+}
+
+bool GridTr_grid_cell_occupied(const struct GridTr_grid_s *grid,
+                               struct ivec3_s crl) {
+  if (!grid)
+    return false;
+  struct ivec3_s brick = GridTr_shr_crl(crl, GridTr_BRICK_SHIFT);
+  return (GridTr_grid_occ_mask(grid->brick_table, brick) & OCC_BIT(crl)) != 0;
+}
+
 struct ivec3_s GridTr_get_grid_cell_for_p(struct vec3_s p, float cell_size) {
   struct ivec3_s crl;
   float s = 1.0f / cell_size;
@@ -92,56 +193,600 @@ void GridTr_get_collider_grid_cell_exts(
   }
 }
 
-void GridTr_add_collider_to_grid(struct GridTr_grid_s *grid,
-                                 const struct GridTr_collider_s *collider) {
-  if (!grid || !collider) {
-    printf("<%s> - invalid grid or collider\n", __FUNCTION__);
-    return;
+// slack around the voxelizer's clipping planes, in cells. covers the TOL
+// the SAT allows for touching plus the rounding of the clipping itself
+#define GridTr_VOXELIZE_MARGIN 1e-2f
+// a clip adds at most one point per edge, so 16 edges fit 256 after four
+#define GridTr_VOXELIZE_MAX_EDGES 16
+
+typedef void (*GridTr_collider_cell_cb)(void *ud, struct ivec3_s crl);
+
+static inline int32 GridTr_cell_coord(float v, float inv_cell_size) {
+  return (int32)floorf(v * inv_cell_size);
+}
+
+// the part of the polygon in s * (p[axis] - v) >= 0, out has room for 2n
+static uint32 GridTr_clip_poly(const struct vec3_s *in, uint32 n, int axis,
+                               float v, float s, struct vec3_s *out) {
+  uint32 m = 0;
+  for (uint32 i = 0; i < n; i++) {
+    struct vec3_s a = in[i], b = in[(i + 1) % n];
+    float da = s * (a.xyz[axis] - v), db = s * (b.xyz[axis] - v);
+    if (da >= 0.0f)
+      out[m++] = a;
+    if ((da > 0.0f && db < 0.0f) || (da < 0.0f && db > 0.0f))
+      out[m++] = vec3_add(a, vec3_mul(vec3_sub(b, a), da / (da - db)));
   }
-  struct GridTr_collider_s blank = {0};
-  GridTr_array_add(grid->colliders, &blank);
-  uint32 idx = grid->colliders->num_elems - 1;
-  GridTr_copy_collider(GridTr_array_get(grid->colliders, idx), collider);
+  return m;
+}
 
-  struct ivec3_s crl_min, crl_max, crl;
+// calls cb for every cell the collider touches, z then y then x ascending.
+// candidates always go through the SAT, the insert mode only decides which
+// cells are candidates (see GridTr_insert_mode_e)
+static void GridTr_grid_collider_cells(const struct GridTr_grid_s *grid,
+                                       const struct GridTr_collider_s *collider,
+                                       GridTr_collider_cell_cb cb, void *ud) {
+  struct ivec3_s crl_min, crl_max;
   struct GridTr_aabb_s aabb;
-  int total = 0;
+  struct GridTr_collider_sat_s sat;
+  bool use_sat = GridTr_collider_sat_init(&sat, collider);
+  float cs = grid->cell_size;
+  GridTr_get_collider_grid_cell_exts(collider, cs, &crl_min, &crl_max, true);
+#define TEST_CELL(x_, y_, z_)                                                  \
+  do {                                                                         \
+    struct ivec3_s crl = ivec3_set(x_, y_, z_);                                \
+    GridTr_get_aabb_for_grid_cell(crl, cs, &aabb);                             \
+    if (use_sat ? GridTr_collider_sat_touches_aabb(&sat, &aabb)                \
+                : GridTr_collider_touches_aabb(collider, &aabb))               \
+      cb(ud, crl);                                                             \
+  } while (0)
+
+  if (grid->insert_mode == GridTr_INSERT_BOX ||
+      collider->edge_count > GridTr_VOXELIZE_MAX_EDGES) {
+    for (int z = crl_min.z; z <= crl_max.z; z++) {
+      for (int y = crl_min.y; y <= crl_max.y; y++) {
+        for (int x = crl_min.x; x <= crl_max.x; x++)
+          TEST_CELL(x, y, z);
+      }
+    }
+    return;
+  }
+
+  // clip the polygon to each layer, then each layer's piece to each row: a
+  // row only has to test the x run its piece spans. everything stays within
+  // the box mode's cells, which GridTr_grid_unlink_collider() relies on
+  float margin = cs * GridTr_VOXELIZE_MARGIN, inv_cs = 1.0f / cs;
+  struct vec3_s half[2 * GridTr_VOXELIZE_MAX_EDGES];
+  struct vec3_s layer[4 * GridTr_VOXELIZE_MAX_EDGES];
+  struct vec3_s half_row[8 * GridTr_VOXELIZE_MAX_EDGES];
+  struct vec3_s row[16 * GridTr_VOXELIZE_MAX_EDGES];
+  struct vec3_s min, max;
+  for (int z = crl_min.z; z <= crl_max.z; z++) {
+    uint32 n = GridTr_clip_poly(collider->ps, collider->edge_count, 2,
+                                (float)z * cs - margin, 1.0f, half);
+    n = GridTr_clip_poly(half, n, 2, (float)(z + 1) * cs + margin, -1.0f,
+                         layer);
+    if (!n)
+      continue;
+    GridTr_find_exts(layer, n, &min, &max);
+    int y_min = MAX(crl_min.y, GridTr_cell_coord(min.y - margin, inv_cs));
+    int y_max = MIN(crl_max.y, GridTr_cell_coord(max.y + margin, inv_cs));
+    for (int y = y_min; y <= y_max; y++) {
+      uint32 m = GridTr_clip_poly(layer, n, 1, (float)y * cs - margin, 1.0f,
+                                  half_row);
+      m = GridTr_clip_poly(half_row, m, 1, (float)(y + 1) * cs + margin, -1.0f,
+                           row);
+      if (!m)
+        continue;
+      GridTr_find_exts(row, m, &min, &max);
+      int x_min = MAX(crl_min.x, GridTr_cell_coord(min.x - margin, inv_cs));
+      int x_max = MIN(crl_max.x, GridTr_cell_coord(max.x + margin, inv_cs));
+      for (int x = x_min; x <= x_max; x++)
+        TEST_CELL(x, y, z);
+    }
+  }
+#undef TEST_CELL
+}
+
+struct GridTr_grid_insert_s {
+  struct GridTr_grid_s *grid;
+  uint32 idx;
+};
+
+static void GridTr_grid_insert_cell(void *ud, struct ivec3_s crl) {
+  struct GridTr_grid_insert_s *ins = ud;
+  struct GridTr_grid_cell_s *cell = GridTr_grid_get_grid_cell(ins->grid, crl);
+  if (cell) {
+    GridTr_grid_cell_add_collider_idx(cell, ins->idx);
+  } else {
+    printf("<%s> - why was this cell not allocated???\n", __FUNCTION__);
+  }
+}
+
+static void GridTr_grid_insert_collider(struct GridTr_grid_s *grid,
+                                       const struct GridTr_collider_s *collider,
+                                       uint32 idx) {
+  struct GridTr_grid_insert_s ins = {grid, idx};
+  GridTr_grid_collider_cells(grid, collider, GridTr_grid_insert_cell, &ins);
+}
+
+// existing cell or NULL, never allocates
+static struct GridTr_grid_cell_s *
+GridTr_grid_find_grid_cell(struct GridTr_grid_s *grid, struct ivec3_s crl) {
+  int64 dense_idx = GridTr_grid_dense_idx(grid, crl);
+  if (dense_idx >= 0)
+    return grid->dense_cells[dense_idx];
+  struct GridTr_grid_cell_s **cell =
+      (struct GridTr_grid_cell_s **)GridTr_hash_table_maybe_get(
+          grid->cell_table, GridTr_grid_cell_key(grid, crl));
+  return cell ? *cell : NULL;
+}
+
+// drops idx from every cell in the collider's extent, cells left empty are
+// freed along with their occupancy bits
+static void GridTr_grid_unlink_collider(struct GridTr_grid_s *grid,
+                                        const struct GridTr_collider_s *collider,
+                                        uint32 idx) {
+  struct ivec3_s crl_min, crl_max;
   GridTr_get_collider_grid_cell_exts(collider, grid->cell_size, &crl_min,
                                      &crl_max, true);
   for (int z = crl_min.z; z <= crl_max.z; z++) {
     for (int y = crl_min.y; y <= crl_max.y; y++) {
       for (int x = crl_min.x; x <= crl_max.x; x++) {
-        crl = ivec3_set(x, y, z);
-        GridTr_get_aabb_for_grid_cell(crl, grid->cell_size, &aabb);
-        if (!GridTr_collider_touches_aabb(collider, &aabb))
+        struct ivec3_s crl = ivec3_set(x, y, z);
+        struct GridTr_grid_cell_s *cell = GridTr_grid_find_grid_cell(grid, crl);
+        if (!cell)
           continue;
-        struct GridTr_grid_cell_s *cell = GridTr_grid_get_grid_cell(grid, crl);
-        if (cell) {
-          // printf(" * %s - adding collider %u to <%d, %d, %d>\n",
-          // __FUNCTION__,
-          //        collider->poly_id, cell->crl.x, cell->crl.y, cell->crl.z);
-          GridTr_grid_cell_add_collider_idx(cell, idx);
-          total++;
-        } else {
-          printf("<%s> - why was this cell not allocated???\n", __FUNCTION__);
-        }
+        uint32 i = 0;
+        while (i < cell->num_colliders && cell->colliders[i] != idx)
+          i++;
+        if (i == cell->num_colliders)
+          continue;
+        // keep the order, lists stay as a rebuild without idx makes them
+        memmove(cell->colliders + i, cell->colliders + i + 1,
+                (cell->num_colliders - i - 1) * sizeof(uint32));
+        cell->num_colliders--;
+        if (cell->num_colliders)
+          continue;
+        int64 dense_idx = GridTr_grid_dense_idx(grid, crl);
+        if (dense_idx >= 0)
+          grid->dense_cells[dense_idx] = NULL;
+        GridTr_grid_mark_empty(grid, crl);
+        GridTr_hash_table_free(grid->cell_table, cell->hash);
       }
     }
   }
-  // printf("<%s> - collider %u touched %d cells\n", __FUNCTION__,
-  //        collider->poly_id, total);
+}
+
+// packets go stale with any change to the colliders
+static void GridTr_grid_drop_tri_packets(struct GridTr_grid_s *grid) {
+  GridTr_free(grid->tri_packets);
+  grid->tri_packets = NULL;
+  grid->num_tri_packets = 0;
+}
+
+// copies collider into slot idx, its edges go to the grid's pool
+static void GridTr_grid_store_collider(struct GridTr_grid_s *grid, uint32 idx,
+                                       const struct GridTr_collider_s *collider) {
+  GridTr_collider_pool_reserve(&grid->collider_pool, grid->colliders->data,
+                               grid->colliders->num_elems,
+                               collider->edge_count);
+  GridTr_copy_collider_pooled(&grid->collider_pool,
+                              GridTr_array_get(grid->colliders, idx), collider);
+}
+
+static bool GridTr_grid_collider_live(const struct GridTr_grid_s *grid,
+                                      uint32 idx) {
+  const struct GridTr_collider_s *collider =
+      GridTr_array_get_ro(grid->colliders, idx);
+  return collider && collider->edge_count;
+}
+
+uint32 GridTr_add_collider_to_grid(struct GridTr_grid_s *grid,
+                                   const struct GridTr_collider_s *collider) {
+  if (!grid || !collider) {
+    printf("<%s> - invalid grid or collider\n", __FUNCTION__);
+    return UINT32_MAX;
+  }
+  if (grid->frozen) {
+    printf("<%s> - grid is frozen\n", __FUNCTION__);
+    return UINT32_MAX;
+  }
+  if (grid->cell_size <= GridTr_CELL_SIZE_AUTO) {
+    // one collider says nothing about the rest of the scene
+    printf("<%s> - cell size not picked yet, build the grid first\n",
+           __FUNCTION__);
+    return UINT32_MAX;
+  }
+  uint32 idx;
+  if (grid->free_colliders->num_elems) {
+    idx = *(uint32 *)GridTr_array_get(grid->free_colliders,
+                                      grid->free_colliders->num_elems - 1);
+    grid->free_colliders->num_elems--;
+  } else {
+    struct GridTr_collider_s blank = {0};
+    GridTr_array_add(grid->colliders, &blank);
+    idx = grid->colliders->num_elems - 1;
+  }
+  GridTr_grid_drop_tri_packets(grid);
+  GridTr_grid_store_collider(grid, idx, collider);
+  GridTr_grid_insert_collider(grid, collider, idx);
+  return idx;
+}
+
+bool GridTr_grid_remove_collider(struct GridTr_grid_s *grid, uint32 idx) {
+  if (!grid || grid->frozen || !GridTr_grid_collider_live(grid, idx)) {
+    printf("<%s> - frozen grid or no collider at %u\n", __FUNCTION__, idx);
+    return false;
+  }
+  GridTr_grid_drop_tri_packets(grid);
+  struct GridTr_collider_s *collider = GridTr_array_get(grid->colliders, idx);
+  GridTr_grid_unlink_collider(grid, collider, idx);
+  GridTr_destroy_collider(collider);
+  memset(collider, 0, sizeof(struct GridTr_collider_s));
+  GridTr_array_add(grid->free_colliders, &idx);
+  return true;
+}
+
+bool GridTr_grid_update_collider(struct GridTr_grid_s *grid, uint32 idx,
+                                 const struct GridTr_collider_s *collider) {
+  if (!grid || !collider || grid->frozen ||
+      !GridTr_grid_collider_live(grid, idx)) {
+    printf("<%s> - frozen grid or no collider at %u\n", __FUNCTION__, idx);
+    return false;
+  }
+  GridTr_grid_drop_tri_packets(grid);
+  struct GridTr_collider_s *stored = GridTr_array_get(grid->colliders, idx);
+  GridTr_grid_unlink_collider(grid, stored, idx);
+  GridTr_destroy_collider(stored);
+  // out of the pool first, so a compaction doesn't carry the old edges
+  memset(stored, 0, sizeof(struct GridTr_collider_s));
+  GridTr_grid_store_collider(grid, idx, collider);
+  GridTr_grid_insert_collider(grid, stored, idx);
+  return true;
+}
+
+struct GridTr_cell_refs_s {
+  const struct GridTr_grid_s *grid;
+  uint32 idx;
+  struct GridTr_array_s *refs;
+};
+
+static void GridTr_add_cell_ref(void *ud, struct ivec3_s crl) {
+  struct GridTr_cell_refs_s *cr = ud;
+  struct GridTr_cell_ref_s ref;
+  ref.key = GridTr_grid_cell_key(cr->grid, crl);
+  ref.crl = crl;
+  ref.idx = cr->idx;
+  GridTr_array_add(cr->refs, &ref);
+}
+
+// appends a cell ref for every cell the collider touches, same cells and
+// order as GridTr_add_collider_to_grid()
+static void GridTr_collider_cell_refs(const struct GridTr_grid_s *grid,
+                                      const struct GridTr_collider_s *collider,
+                                      uint32 idx, struct GridTr_array_s *refs) {
+  struct GridTr_cell_refs_s cr = {grid, idx, refs};
+  GridTr_grid_collider_cells(grid, collider, GridTr_add_cell_ref, &cr);
+}
+
+// stable lsd radix sort on the key, 8 bits a pass. passes where every key
+// has the same digit are skipped. returns whichever buffer holds the result
+static struct GridTr_cell_ref_s *
+GridTr_sort_cell_refs(struct GridTr_cell_ref_s *refs,
+                      struct GridTr_cell_ref_s *tmp, uint32 n) {
+  uint32 counts[8][256] = {{0}};
+  for (uint32 i = 0; i < n; i++) {
+    uint64 key = refs[i].key;
+    for (int d = 0; d < 8; d++)
+      counts[d][(key >> (d * 8)) & 0xff]++;
+  }
+  for (int d = 0; d < 8; d++) {
+    if (counts[d][(refs[0].key >> (d * 8)) & 0xff] == n)
+      continue;
+    uint32 sum = 0;
+    for (int b = 0; b < 256; b++) {
+      uint32 c = counts[d][b];
+      counts[d][b] = sum;
+      sum += c;
+    }
+    for (uint32 i = 0; i < n; i++)
+      tmp[counts[d][(refs[i].key >> (d * 8)) & 0xff]++] = refs[i];
+    struct GridTr_cell_ref_s *swap = refs;
+    refs = tmp;
+    tmp = swap;
+  }
+  return refs;
+}
+
+static void GridTr_grid_cell_reserve(struct GridTr_grid_cell_s *cell,
+                                     uint32 max_colliders) {
+  if (max_colliders <= cell->_max_colliders_)
+    return;
+  uint32 *colliders = GridTr_new(max_colliders * sizeof(uint32));
+  if (cell->num_colliders)
+    memcpy(colliders, cell->colliders, cell->num_colliders * sizeof(uint32));
+  GridTr_free(cell->colliders);
+  cell->colliders = colliders;
+  cell->_max_colliders_ = max_colliders;
+}
+
+static struct GridTr_grid_cell_s *
+GridTr_grid_get_grid_cell_(struct GridTr_grid_s *grid, struct ivec3_s crl,
+                           uint32 max_colliders);
+
+// refs are sorted by key, so each run is one cell's new colliders in
+// insertion order
+static void GridTr_grid_scatter_cell_refs(struct GridTr_grid_s *grid,
+                                          const struct GridTr_cell_ref_s *refs,
+                                          uint32 n) {
+  for (uint32 i = 0; i < n;) {
+    uint32 j = i + 1;
+    while (j < n && refs[j].key == refs[i].key)
+      j++;
+    struct GridTr_grid_cell_s *cell =
+        GridTr_grid_get_grid_cell_(grid, refs[i].crl, j - i);
+    if (cell) {
+      GridTr_grid_cell_reserve(cell, cell->num_colliders + (j - i));
+      for (uint32 k = i; k < j; k++)
+        cell->colliders[cell->num_colliders++] = refs[k].idx;
+    }
+    i = j;
+  }
+}
+
+#define GridTr_BUILD_CHUNK 256
+
+struct GridTr_build_parallel_s {
+  const struct GridTr_grid_s *grid;
+  const struct GridTr_collider_s *colliders;
+  uint32 num_colliders;
+  uint32 base_idx;
+  struct GridTr_array_s **refs; // one list per task
+};
+
+static void GridTr_build_parallel_task(void *ctx, uint32 task, uint32 worker) {
+  (void)worker;
+  struct GridTr_build_parallel_s *build = ctx;
+  uint32 begin = task * GridTr_BUILD_CHUNK;
+  uint32 end = MIN(begin + GridTr_BUILD_CHUNK, build->num_colliders);
+  struct GridTr_array_s *refs =
+      GridTr_create_array(sizeof(struct GridTr_cell_ref_s),
+                          GridTr_BUILD_CHUNK * 8, GridTr_BUILD_CHUNK * 8);
+  for (uint32 i = begin; i < end; i++) {
+    GridTr_collider_cell_refs(build->grid, &build->colliders[i],
+                              build->base_idx + i, refs);
+  }
+  build->refs[task] = refs;
+}
+
+// pool NULL runs the classification on the calling thread. returns false
+// without touching the grid if it is frozen or the arguments are bad
+static bool GridTr_build_grid_(struct GridTr_thread_pool_s *pool,
+                               struct GridTr_grid_s *grid,
+                               const struct GridTr_collider_s *colliders,
+                               uint32 num_colliders) {
+  if (!grid || (!colliders && num_colliders) || grid->frozen)
+    return false;
+  if (grid->cell_size <= GridTr_CELL_SIZE_AUTO && num_colliders)
+    grid->cell_size = GridTr_suggest_cell_size(colliders, num_colliders, NULL);
+  GridTr_grid_drop_tri_packets(grid);
+  struct GridTr_build_parallel_s build;
+  build.grid = grid;
+  build.colliders = colliders;
+  build.num_colliders = num_colliders;
+  build.base_idx = grid->colliders->num_elems;
+  GridTr_array_reserve(grid->colliders, build.base_idx + num_colliders);
+  uint32 num_edges = 0;
+  for (uint32 i = 0; i < num_colliders; i++)
+    num_edges += colliders[i].edge_count;
+  GridTr_collider_pool_reserve(&grid->collider_pool, grid->colliders->data,
+                               grid->colliders->num_elems, num_edges);
+  for (uint32 i = 0; i < num_colliders; i++) {
+    struct GridTr_collider_s blank = {0};
+    GridTr_array_add(grid->colliders, &blank);
+    GridTr_copy_collider_pooled(
+        &grid->collider_pool,
+        GridTr_array_get(grid->colliders, grid->colliders->num_elems - 1),
+        &colliders[i]);
+  }
+
+  // classify (the SAT tests) in parallel, each task into its own list
+  uint32 num_tasks = (num_colliders + GridTr_BUILD_CHUNK - 1) /
+                     GridTr_BUILD_CHUNK;
+  build.refs = GridTr_new(MAX(num_tasks, 1) * PTR_SZ);
+  if (pool) {
+    GridTr_thread_pool_run(pool, GridTr_build_parallel_task, &build,
+                           num_tasks);
+  } else {
+    for (uint32 t = 0; t < num_tasks; t++)
+      GridTr_build_parallel_task(&build, t, 0);
+  }
+
+  // concatenate in task order, so refs of a cell stay in collider order
+  uint32 num_refs = 0;
+  for (uint32 t = 0; t < num_tasks; t++)
+    num_refs += build.refs[t]->num_elems;
+  size_t refs_size = MAX(num_refs, 1) * sizeof(struct GridTr_cell_ref_s);
+  struct GridTr_cell_ref_s *refs = GridTr_new(refs_size);
+  struct GridTr_cell_ref_s *tmp = GridTr_new(refs_size);
+  uint32 at = 0;
+  for (uint32 t = 0; t < num_tasks; t++) {
+    struct GridTr_array_s *task_refs = build.refs[t];
+    memcpy(refs + at, task_refs->data,
+           task_refs->num_elems * sizeof(struct GridTr_cell_ref_s));
+    at += task_refs->num_elems;
+    GridTr_destroy_array(&build.refs[t]);
+  }
+  GridTr_free(build.refs);
+
+  if (num_refs) {
+    GridTr_grid_scatter_cell_refs(grid, GridTr_sort_cell_refs(refs, tmp, num_refs),
+                                  num_refs);
+  }
+  GridTr_free(refs);
+  GridTr_free(tmp);
+  return true;
+}
+
+void GridTr_build_grid(struct GridTr_grid_s *grid,
+                       const struct GridTr_collider_s *colliders,
+                       uint32 num_colliders) {
+  if (!GridTr_build_grid_(NULL, grid, colliders, num_colliders))
+    printf("<%s> - invalid argument(s) or frozen grid\n", __FUNCTION__);
+}
+
+void GridTr_build_grid_parallel(struct GridTr_thread_pool_s *pool,
+                                struct GridTr_grid_s *grid,
+                                const struct GridTr_collider_s *colliders,
+                                uint32 num_colliders) {
+  if (!pool || !GridTr_build_grid_(pool, grid, colliders, num_colliders))
+    printf("<%s> - invalid argument(s) or frozen grid\n", __FUNCTION__);
+}
+
+// relative costs: stepping a cell, looking up an occupied cell (brick mask
+// and table lookup), one ray vs polygon test
+#define GridTr_COST_STEP 1.0
+#define GridTr_COST_CELL 8.0
+#define GridTr_COST_TEST 1.0
+
+float GridTr_suggest_cell_size(const struct GridTr_collider_s *colliders,
+                               uint32 num_colliders,
+                               const struct GridTr_cell_size_target_s *target) {
+  if (!colliders || !num_colliders)
+    return 1.0f;
+  double area = 0.0, perimeter = 0.0;
+  uint32 num_edges = 0;
+  // not seeded from colliders[0], it may have no points
+  struct vec3_s min = vec3_set(FLT_MAX, FLT_MAX, FLT_MAX);
+  struct vec3_s max = vec3_set(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+  for (uint32 i = 0; i < num_colliders; i++) {
+    const struct GridTr_collider_s *c = &colliders[i];
+    for (uint32 k = 0; k < c->edge_count; k++) {
+      perimeter += c->edge_lens[k];
+      min = vec3_min(min, c->ps[k]);
+      max = vec3_max(max, c->ps[k]);
+      if (k >= 2)
+        area += 0.5 * vec3_len(vec3_cross(point_vec(c->ps[0], c->ps[k - 1]),
+                                          point_vec(c->ps[0], c->ps[k])));
+    }
+    num_edges += c->edge_count;
+  }
+  if (!num_edges)
+    return 1.0f;
+  double mean_edge = perimeter / num_edges;
+  if (mean_edge <= TOL)
+    return 1.0f;
+  struct vec3_s ext = point_vec(min, max);
+  double n = (double)num_colliders;
+
+  double best_s = mean_edge, best_cost = DBL_MAX;
+  double fallback_s = mean_edge, fallback_mem = DBL_MAX;
+  // mean_edge / 8 ... mean_edge * 64, four steps per doubling
+  for (int k = -12; k <= 24; k++) {
+    double s = mean_edge * pow(2.0, k * 0.25);
+    double dx = MAX(ext.x, s), dy = MAX(ext.y, s), dz = MAX(ext.z, s);
+    double num_cells = (dx / s) * (dy / s) * (dz / s);
+    if (num_cells > (double)(1ull << 40))
+      continue;
+    // cells a polygon touches: its area on the ~1.5 faces per cell an
+    // average orientation shows, plus the cells along its edges
+    double refs = 1.5 * area / (s * s) + perimeter / s + n;
+    double occupied = MIN(refs, num_cells);
+    double mem = occupied * (sizeof(struct GridTr_grid_cell_s) +
+                             sizeof(struct GridTr_hash_table_entry_s)) +
+                 refs * sizeof(uint32);
+    double visited = (dx + dy + dz) / (3.0 * s) + 1.0;
+    double tests = MIN(n, visited * refs / num_cells);
+    double cost = visited * (GridTr_COST_STEP +
+                             GridTr_COST_CELL * occupied / num_cells) +
+                  GridTr_COST_TEST * tests;
+    if (mem < fallback_mem) {
+      fallback_mem = mem;
+      fallback_s = s;
+    }
+    if (target && target->goal == GridTr_CELL_SIZE_MEMORY_BUDGET &&
+        mem > (double)target->memory_budget)
+      continue;
+    if (cost < best_cost) {
+      best_cost = cost;
+      best_s = s;
+    }
+  }
+  // nothing fits the budget, go as coarse as the candidates allow
+  return (float)(best_cost < DBL_MAX ? best_s : fallback_s);
 }
 
 void GridTr_create_grid(struct GridTr_grid_s *grid, float cell_size) {
   if (!grid) {
     return;
   }
+  // written so NaN fails it too
+  if (!(cell_size >= GridTr_CELL_SIZE_AUTO) || isinf(cell_size)) {
+    printf("<%s> - invalid cell size %f, using GridTr_CELL_SIZE_AUTO\n",
+           __FUNCTION__, cell_size);
+    cell_size = GridTr_CELL_SIZE_AUTO;
+  }
   grid->cell_size = cell_size;
   grid->cell_table = GridTr_create_hash_table(256, GridTr_grid_cell_dtor);
+  grid->brick_table = GridTr_create_hash_table(256, GridTr_grid_occ_dtor);
+  grid->macro_table = GridTr_create_hash_table(256, GridTr_grid_occ_dtor);
+  grid->occ_min = ivec3_set(INT32_MAX, INT32_MAX, INT32_MAX);
+  grid->occ_max = ivec3_set(INT32_MIN, INT32_MIN, INT32_MIN);
   grid->colliders =
       GridTr_create_array(sizeof(struct GridTr_collider_s), 4096, 4096);
   grid->colliders->oftype = GridTr_oftype(struct GridTr_collider_s);
+  grid->free_colliders = GridTr_create_array(sizeof(uint32), 64, 64);
+  GridTr_create_collider_pool(&grid->collider_pool, 0);
   GridTr_aabb_init(&grid->aabb, vec3_zero(), vec3_zero());
+  grid->dense_cells = NULL;
+  grid->dense_min = grid->dense_dims = ivec3_set(0, 0, 0);
+  grid->frozen = NULL;
+  grid->cell_key = GridTr_CELL_KEY_FNV1A;
+  grid->tri_packets = NULL;
+  grid->num_tri_packets = 0;
+  grid->insert_mode = GridTr_INSERT_VOXELIZE;
+}
+
+bool GridTr_grid_set_cell_key(struct GridTr_grid_s *grid,
+                              enum GridTr_cell_key_e cell_key) {
+  if (!grid || !grid->cell_table || grid->cell_table->total_elems) {
+    printf("<%s> - cell keys can only change on an empty grid\n",
+           __FUNCTION__);
+    return false;
+  }
+  grid->cell_key = cell_key;
+  return true;
+}
+
+void GridTr_create_grid_dense(struct GridTr_grid_s *grid, float cell_size,
+                              const struct GridTr_aabb_s *bounds) {
+  GridTr_create_grid(grid, cell_size);
+  if (!grid || !bounds) {
+    return;
+  }
+  if (grid->cell_size <= GridTr_CELL_SIZE_AUTO) {
+    printf("<%s> - dense grids need a cell size, staying sparse\n",
+           __FUNCTION__);
+    return;
+  }
+  grid->aabb = *bounds;
+  struct ivec3_s crl_min =
+      GridTr_get_grid_cell_for_p(bounds->min, grid->cell_size);
+  struct ivec3_s crl_max =
+      GridTr_get_grid_cell_for_p(bounds->max, grid->cell_size);
+  struct ivec3_s dims = ivec3_add(ivec3_sub(crl_max, crl_min), ivec3_set(1, 1, 1));
+  uint64 total = (uint64)dims.x * (uint64)dims.y * (uint64)dims.z;
+  if (dims.x <= 0 || dims.y <= 0 || dims.z <= 0 ||
+      total > GridTr_DENSE_MAX_CELLS) {
+    printf("<%s> - bounds span %d x %d x %d cells, staying sparse\n",
+           __FUNCTION__, dims.x, dims.y, dims.z);
+    return;
+  }
+  grid->dense_min = crl_min;
+  grid->dense_dims = dims;
+  grid->dense_cells = GridTr_new(total * PTR_SZ);
+  memset(grid->dense_cells, 0, total * PTR_SZ);
 }
 
 void GridTr_destroy_grid(struct GridTr_grid_s *grid) {
@@ -149,16 +794,107 @@ void GridTr_destroy_grid(struct GridTr_grid_s *grid) {
     return;
   }
   GridTr_destroy_hash_table(&grid->cell_table);
+  GridTr_destroy_hash_table(&grid->brick_table);
+  GridTr_destroy_hash_table(&grid->macro_table);
   GridTr_destroy_array_dtor(&grid->colliders, GridTr_collider_dtor);
+  GridTr_destroy_collider_pool(&grid->collider_pool);
+  GridTr_destroy_array(&grid->free_colliders);
+  GridTr_free(grid->dense_cells); // cells are owned by cell_table
+  GridTr_free(grid->frozen);
+  GridTr_grid_drop_tri_packets(grid);
   grid->cell_size = 0.0f;
 }
 
-struct GridTr_grid_cell_s *GridTr_grid_get_grid_cell(struct GridTr_grid_s *grid,
-                                                     struct ivec3_s crl) {
+static const struct GridTr_grid_cell_s *
+GridTr_grid_frozen_find(const struct GridTr_grid_frozen_s *frozen, uint64 key) {
+  uint32 lo = 0, hi = frozen->num_cells;
+  while (lo < hi) {
+    uint32 mid = lo + ((hi - lo) >> 1);
+    if (frozen->keys[mid] < key)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo < frozen->num_cells && frozen->keys[lo] == key)
+    return &frozen->cells[lo];
+  return NULL;
+}
+
+// galloping search out from a previous hit, cheap when consecutive lookups
+// are spatial neighbours and the keys are morton ordered
+static const struct GridTr_grid_cell_s *
+GridTr_grid_frozen_find_near(const struct GridTr_grid_frozen_s *frozen,
+                             uint64 key, uint32 *hint) {
+  uint32 n = frozen->num_cells;
+  if (!n)
+    return NULL;
+  uint32 at = MIN(*hint, n - 1);
+  uint32 lo, hi; // key is in [lo, hi)
+  if (frozen->keys[at] == key) {
+    return &frozen->cells[at];
+  } else if (frozen->keys[at] < key) {
+    uint32 step = 1;
+    lo = at + 1;
+    hi = lo;
+    while (hi < n && frozen->keys[hi] < key) {
+      lo = hi + 1;
+      hi = MIN(n, hi + step);
+      step <<= 1;
+    }
+    hi = MIN(n, hi + 1);
+  } else {
+    uint32 step = 1;
+    hi = at;
+    lo = hi;
+    while (lo > 0 && frozen->keys[lo - 1] > key) {
+      hi = lo - 1;
+      lo = lo > step ? lo - step : 0;
+      step <<= 1;
+    }
+    lo = lo > 0 ? lo - 1 : 0;
+  }
+  while (lo < hi) {
+    uint32 mid = lo + ((hi - lo) >> 1);
+    if (frozen->keys[mid] < key)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if (lo < n && frozen->keys[lo] == key) {
+    *hint = lo;
+    return &frozen->cells[lo];
+  }
+  return NULL;
+}
+
+uint64 GridTr_grid_cell_key(const struct GridTr_grid_s *grid,
+                            struct ivec3_s crl) {
+  if (grid->cell_key != GridTr_CELL_KEY_MORTON)
+    return ivec3_fnv1a(crl);
+  // morton codes only hold 21 bits per axis and never set bit 63. cells
+  // further out would alias one inside, they get a flagged fnv1a key
+  const int lim = 1 << 20;
+  if (crl.x < -lim || crl.x >= lim || crl.y < -lim || crl.y >= lim ||
+      crl.z < -lim || crl.z >= lim)
+    return ivec3_fnv1a(crl) | (1ull << 63);
+  return ivec3_morton(crl);
+}
+
+static struct GridTr_grid_cell_s *
+GridTr_grid_get_grid_cell_(struct GridTr_grid_s *grid, struct ivec3_s crl,
+                           uint32 max_colliders) {
   if (!grid) {
     return NULL;
   }
-  uint64 hash = ivec3_fnv1a(crl);
+  int64 dense_idx = GridTr_grid_dense_idx(grid, crl);
+  if (dense_idx >= 0 && grid->dense_cells[dense_idx]) {
+    return grid->dense_cells[dense_idx];
+  }
+  if (grid->frozen) {
+    printf("<%s> - grid is frozen\n", __FUNCTION__);
+    return NULL;
+  }
+  uint64 hash = GridTr_grid_cell_key(grid, crl);
   struct GridTr_grid_cell_s **cell =
       (struct GridTr_grid_cell_s **)GridTr_hash_table_maybe_get(
           grid->cell_table, hash);
@@ -173,162 +909,521 @@ struct GridTr_grid_cell_s *GridTr_grid_get_grid_cell(struct GridTr_grid_s *grid,
       (*cell)->crl = crl;
       (*cell)->hash = hash;
       (*cell)->num_colliders = 0;
-      (*cell)->colliders = GridTr_new(16 * sizeof(uint32));
-      (*cell)->_max_colliders_ = 16;
+      (*cell)->colliders = GridTr_new(max_colliders * sizeof(uint32));
+      (*cell)->_max_colliders_ = max_colliders;
+      (*cell)->first_tri_packet = (*cell)->num_tri_packets = 0;
       GridTr_get_aabb_for_grid_cell(crl, grid->cell_size, &(*cell)->aabb);
+      GridTr_grid_mark_occupied(grid, crl);
+      if (dense_idx >= 0) {
+        grid->dense_cells[dense_idx] = *cell;
+      }
       return *cell;
     }
   }
   return NULL;
 }
 
+struct GridTr_grid_cell_s *GridTr_grid_get_grid_cell(struct GridTr_grid_s *grid,
+                                                     struct ivec3_s crl) {
+  return GridTr_grid_get_grid_cell_(grid, crl, 16);
+}
+
 const struct GridTr_grid_cell_s *
 GridTr_grid_get_grid_cell_ro(const struct GridTr_grid_s *grid,
                              struct ivec3_s crl) {
   if (!grid) {
     return NULL;
   }
-  uint64 hash = ivec3_fnv1a(crl);
+  int64 dense_idx = GridTr_grid_dense_idx(grid, crl);
+  if (dense_idx >= 0) {
+    return grid->dense_cells[dense_idx];
+  }
+  uint64 hash = GridTr_grid_cell_key(grid, crl);
+  if (grid->frozen) {
+    return GridTr_grid_frozen_find(grid->frozen, hash);
+  }
   const struct GridTr_grid_cell_s *cell =
       (const struct GridTr_grid_cell_s *)GridTr_hash_table_maybe_get_ro(
           grid->cell_table, hash);
   return cell;
 }
 
+const struct GridTr_grid_cell_s *
+GridTr_grid_get_grid_cell_ro_hint(const struct GridTr_grid_s *grid,
+                                  struct ivec3_s crl, uint32 *hint) {
+  if (!grid || !hint) {
+    return NULL;
+  }
+  int64 dense_idx = GridTr_grid_dense_idx(grid, crl);
+  if (dense_idx >= 0) {
+    return grid->dense_cells[dense_idx];
+  }
+  // fnv1a keys of neighbours land anywhere, galloping from the last one
+  // only adds steps to the plain binary search
+  if (grid->frozen && grid->cell_key == GridTr_CELL_KEY_MORTON) {
+    return GridTr_grid_frozen_find_near(grid->frozen,
+                                        GridTr_grid_cell_key(grid, crl), hint);
+  }
+  return GridTr_grid_get_grid_cell_ro(grid, crl);
+}
+
 const void **GridTr_grid_get_all_grid_cells(const struct GridTr_grid_s *grid,
                                             uint32 *num_cells) {
   if (!grid || !num_cells) {
     return NULL;
   }
+  if (grid->frozen) {
+    *num_cells = grid->frozen->num_cells;
+    if (!*num_cells) {
+      return NULL;
+    }
+    const void **ptrs = GridTr_new(*num_cells * PTR_SZ);
+    for (uint32 i = 0; i < *num_cells; i++) {
+      ptrs[i] = &grid->frozen->cells[i];
+    }
+    return ptrs;
+  }
   return GridTr_hash_table_get_all_ro(grid->cell_table, num_cells);
 }
 
-// GridTr_step_ray_through_grid_cell:
-// * assumes rayseg->o is inside the cell defined by crl
-// * clips the ray end to the cell boundaries
-static bool GridTr_step_ray_through_grid_cell(const struct GridTr_grid_s *grid,
-                                              struct GridTr_rayseg_s *rayseg,
-                                              struct ivec3_s *crl) {
+// fan diagonal ps[j] -> ps[0] as an edge plane, outside positive like the
+// collider's own edge_planes
+static struct GridTr_plane_s
+GridTr_tri_packet_diagonal(const struct GridTr_collider_s *collider,
+                           uint32 j) {
+  struct vec3_s e = vec3_sub(collider->ps[0], collider->ps[j]);
+  return GridTr_create_plane(vec3_cross(e, collider->plane.n),
+                             collider->ps[j]);
+}
 
-  const float dir_eps = 1e-12f;
+static void GridTr_tri_packet_set_edge(struct GridTr_tri_packet_s *packet,
+                                       uint32 lane, uint32 e,
+                                       struct GridTr_plane_s pl, float tol) {
+  packet->enx[e][lane] = pl.n.x;
+  packet->eny[e][lane] = pl.n.y;
+  packet->enz[e][lane] = pl.n.z;
+  packet->edist[e][lane] = pl.dist;
+  packet->etol[e][lane] = tol;
+}
 
-  const float dx = rayseg->d.x;
-  const float dy = rayseg->d.y;
-  const float dz = rayseg->d.z;
+// lane-th triangle of packet: the fan triangle (ps[0], ps[k], ps[k + 1])
+static void GridTr_tri_packet_set(struct GridTr_tri_packet_s *packet,
+                                  uint32 lane,
+                                  const struct GridTr_collider_s *collider,
+                                  uint32 k, uint32 idx) {
+  packet->nx[lane] = collider->plane.n.x;
+  packet->ny[lane] = collider->plane.n.y;
+  packet->nz[lane] = collider->plane.n.z;
+  packet->dist[lane] = collider->plane.dist;
+  // ps[k] -> ps[k + 1] is always one of the polygon's edges
+  GridTr_tri_packet_set_edge(packet, lane, 0, collider->edge_planes[k], TOL);
+  // ps[k + 1] -> ps[0]
+  if (k + 2 == collider->edge_count) {
+    GridTr_tri_packet_set_edge(packet, lane, 1, collider->edge_planes[k + 1],
+                               TOL);
+  } else {
+    GridTr_tri_packet_set_edge(packet, lane, 1,
+                               GridTr_tri_packet_diagonal(collider, k + 1),
+                               0.0f);
+  }
+  // ps[0] -> ps[k], the negation of triangle k - 1's diagonal so a point
+  // exactly on it still lands in one of the two
+  if (k == 1) {
+    GridTr_tri_packet_set_edge(packet, lane, 2, collider->edge_planes[0], TOL);
+  } else {
+    struct GridTr_plane_s pl = GridTr_tri_packet_diagonal(collider, k);
+    pl.n = vec3_mul(pl.n, -1.0f);
+    pl.dist = -pl.dist;
+    GridTr_tri_packet_set_edge(packet, lane, 2, pl, 0.0f);
+  }
+  packet->idx[lane] = idx;
+}
 
-  if (fabsf(dx) <= dir_eps && fabsf(dy) <= dir_eps && fabsf(dz) <= dir_eps) {
-    // no ray!!!
+bool GridTr_grid_build_tri_packets(struct GridTr_grid_s *grid) {
+  if (!grid || !grid->colliders) {
+    printf("<%s> - invalid grid\n", __FUNCTION__);
     return false;
   }
+  GridTr_grid_drop_tri_packets(grid);
+  const struct GridTr_collider_s *colliders = grid->colliders->data;
+  uint32 num_cells = 0;
+  // cells are only written here, queries see them through const pointers
+  struct GridTr_grid_cell_s **cells =
+      (struct GridTr_grid_cell_s **)GridTr_grid_get_all_grid_cells(grid,
+                                                                   &num_cells);
+  uint32 num_packets = 0;
+  for (uint32 i = 0; i < num_cells; i++) {
+    struct GridTr_grid_cell_s *cell = cells[i];
+    uint32 num_tris = 0;
+    for (uint32 j = 0; j < cell->num_colliders; j++) {
+      uint32 edge_count = colliders[cell->colliders[j]].edge_count;
+      num_tris += edge_count > 2 ? edge_count - 2 : 0;
+    }
+    cell->first_tri_packet = num_packets;
+    cell->num_tri_packets =
+        (num_tris + GridTr_SIMD_WIDTH - 1) / GridTr_SIMD_WIDTH;
+    num_packets += cell->num_tri_packets;
+  }
 
-  struct vec3_s cmin, cmax;
-  GridTr_get_exts_for_grid_cell(*crl, grid->cell_size, &cmin, &cmax);
+  // zero planes and no collider in the padding lanes, those never hit
+  size_t size = MAX(num_packets, 1) * sizeof(struct GridTr_tri_packet_s);
+  struct GridTr_tri_packet_s *packets = GridTr_new(size);
+  memset(packets, 0, size);
+  for (uint32 i = 0; i < num_packets; i++) {
+    for (uint32 lane = 0; lane < GridTr_SIMD_WIDTH; lane++)
+      packets[i].idx[lane] = UINT32_MAX;
+  }
+  for (uint32 i = 0; i < num_cells; i++) {
+    const struct GridTr_grid_cell_s *cell = cells[i];
+    uint32 at = cell->first_tri_packet * GridTr_SIMD_WIDTH;
+    for (uint32 j = 0; j < cell->num_colliders; j++) {
+      uint32 idx = cell->colliders[j];
+      const struct GridTr_collider_s *collider = &colliders[idx];
+      for (uint32 k = 1; k + 1 < collider->edge_count; k++, at++) {
+        GridTr_tri_packet_set(&packets[at / GridTr_SIMD_WIDTH],
+                              at % GridTr_SIMD_WIDTH, collider, k, idx);
+      }
+    }
+  }
+  void *ptr = (void *)cells;
+  GridTr_free(ptr);
+  grid->tri_packets = packets;
+  grid->num_tri_packets = num_packets;
+  return true;
+}
 
-  // Distance along ray (t) to the next boundary on each axis
-  float tx = INFINITY, ty = INFINITY, tz = INFINITY;
+static int GridTr_cmp_cell_keys(const void *a, const void *b) {
+  uint64 ka = (*(const struct GridTr_grid_cell_s *const *)a)->hash;
+  uint64 kb = (*(const struct GridTr_grid_cell_s *const *)b)->hash;
+  return ka < kb ? -1 : ka > kb ? 1 : 0;
+}
 
-  if (dx > dir_eps)
-    tx = (cmax.x - rayseg->o.x) / dx;
-  else if (dx < -dir_eps)
-    tx = (cmin.x - rayseg->o.x) / dx; // dx negative => positive tx
+bool GridTr_grid_freeze(struct GridTr_grid_s *grid) {
+  if (!grid || grid->frozen) {
+    printf("<%s> - invalid or already frozen grid\n", __FUNCTION__);
+    return false;
+  }
+  uint32 num_cells = 0;
+  const struct GridTr_grid_cell_s **cells =
+      (const struct GridTr_grid_cell_s **)GridTr_hash_table_get_all_ro(
+          grid->cell_table, &num_cells);
+  if (num_cells) {
+    qsort(cells, num_cells, PTR_SZ, GridTr_cmp_cell_keys);
+  }
+  uint32 num_indices = 0;
+  for (uint32 i = 0; i < num_cells; i++) {
+    num_indices += cells[i]->num_colliders;
+  }
 
-  if (dy > dir_eps)
-    ty = (cmax.y - rayseg->o.y) / dy;
-  else if (dy < -dir_eps)
-    ty = (cmin.y - rayseg->o.y) / dy;
+  // header | cells | keys | offsets | indices, all in one allocation
+  size_t cells_at = sizeof(struct GridTr_grid_frozen_s);
+  size_t keys_at = cells_at + num_cells * sizeof(struct GridTr_grid_cell_s);
+  size_t offsets_at = keys_at + num_cells * sizeof(uint64);
+  size_t indices_at = offsets_at + (num_cells + 1) * sizeof(uint32);
+  size_t size = indices_at + num_indices * sizeof(uint32);
+  uint8 *block = GridTr_new(size);
+  struct GridTr_grid_frozen_s *frozen = (struct GridTr_grid_frozen_s *)block;
+  frozen->num_cells = num_cells;
+  frozen->num_indices = num_indices;
+  frozen->cells = (struct GridTr_grid_cell_s *)(block + cells_at);
+  frozen->keys = (uint64 *)(block + keys_at);
+  frozen->offsets = (uint32 *)(block + offsets_at);
+  frozen->indices = (uint32 *)(block + indices_at);
 
-  if (dz > dir_eps)
-    tz = (cmax.z - rayseg->o.z) / dz;
-  else if (dz < -dir_eps)
-    tz = (cmin.z - rayseg->o.z) / dz;
+  uint32 at = 0;
+  for (uint32 i = 0; i < num_cells; i++) {
+    struct GridTr_grid_cell_s *cell = &frozen->cells[i];
+    *cell = *cells[i];
+    frozen->keys[i] = cell->hash;
+    frozen->offsets[i] = at;
+    memcpy(&frozen->indices[at], cells[i]->colliders,
+           cell->num_colliders * sizeof(uint32));
+    cell->colliders = &frozen->indices[at];
+    cell->_max_colliders_ = cell->num_colliders;
+    at += cell->num_colliders;
 
-  float t = tx;
-  if (ty < t)
-    t = ty;
-  if (tz < t)
-    t = tz;
-  if (t < 0.0f)
-    t = 0.0f;
+    int64 dense_idx = GridTr_grid_dense_idx(grid, cell->crl);
+    if (dense_idx >= 0) {
+      grid->dense_cells[dense_idx] = cell;
+    }
+  }
+  frozen->offsets[num_cells] = at;
 
-  if (t >= rayseg->len) {
+  void *ptr = (void *)cells;
+  GridTr_free(ptr);
+  GridTr_destroy_hash_table(&grid->cell_table);
+  grid->frozen = frozen;
+  return true;
+}
+
+// sets t_enter and finds where the current cell is left
+static void GridTr_grid_walk_enter(struct GridTr_grid_walk_s *walk, float t) {
+  walk->t_enter = t;
+  t = MIN(walk->t_max.x, MIN(walk->t_max.y, walk->t_max.z));
+  walk->t_exit = MAX(t, walk->t_enter);
+  walk->last = walk->t_exit >= walk->len;
+  if (walk->last)
+    walk->t_exit = walk->len;
+}
+
+void GridTr_grid_walk_init(struct GridTr_grid_walk_s *walk,
+                           const struct GridTr_grid_s *grid,
+                           const struct GridTr_rayseg_s *rayseg) {
+  const float dir_eps = 1e-12f;
+  float cell_size = grid->cell_size;
+
+  walk->crl = GridTr_get_grid_cell_for_p(rayseg->o, cell_size);
+  walk->len = rayseg->len;
+  walk->eps = cell_size * 1e-5f;
+
+  // one division per axis for the whole ray, stepping is adds and compares
+  for (int i = 0; i < 3; i++) {
+    float d = rayseg->d.xyz[i];
+    float o = rayseg->o.xyz[i];
+    float cmin = (float)walk->crl.xyz[i] * cell_size;
+    if (d > dir_eps) {
+      walk->step.xyz[i] = 1;
+      walk->t_delta.xyz[i] = cell_size / d;
+      walk->t_max.xyz[i] = (cmin + cell_size - o) / d;
+    } else if (d < -dir_eps) {
+      walk->step.xyz[i] = -1;
+      walk->t_delta.xyz[i] = -cell_size / d;
+      walk->t_max.xyz[i] = (cmin - o) / d; // d negative => positive t
+    } else {
+      walk->step.xyz[i] = 0;
+      walk->t_delta.xyz[i] = INFINITY;
+      walk->t_max.xyz[i] = INFINITY;
+    }
+  }
+  GridTr_grid_walk_enter(walk, 0.0f);
+
+  walk->macro_crl = walk->brick_crl = ivec3_set(INT32_MIN, INT32_MIN, 0);
+  walk->macro_mask = walk->brick_mask = 0;
+  walk->cell_hint = 0;
+}
+
+bool GridTr_grid_walk_step(struct GridTr_grid_walk_s *walk) {
+  if (walk->last)
+    return false;
+
+  // If ties, we crossed an edge/corner -> step multiple axes.
+  float t = walk->t_exit;
+  float eps = TIE_EPS(t - walk->t_enter);
+  for (int i = 0; i < 3; i++) {
+    if (fabsf(walk->t_max.xyz[i] - t) <= eps) {
+      walk->crl.xyz[i] += walk->step.xyz[i];
+      walk->t_max.xyz[i] += walk->t_delta.xyz[i];
+    }
+  }
+  if (walk->len - t < walk->eps) {
+    walk->t_enter = t;
     return false;
   }
+  GridTr_grid_walk_enter(walk, t);
+  return true;
+}
 
-  rayseg->e = vec3_add(rayseg->o, vec3_mul(rayseg->d, t));
-  rayseg->len = t;
+// leaves the aligned block of 2^shift cells (per axis) holding the current
+// cell in one go, i.e. as many plain steps as it takes to cross it
+static bool GridTr_grid_walk_jump(struct GridTr_grid_walk_s *walk, int shift) {
+  if (walk->last)
+    return false;
 
-  // Step cell indices. If ties, we crossed an edge/corner -> step multiple
-  // axes.
-  float eps = TIE_EPS(t);
-  if (fabsf(tx - t) <= eps) {
-    crl->x += (dx < 0.0f) ? -1 : 1;
+  int size = 1 << shift;
+  int k[3];
+  float t = INFINITY;
+  for (int i = 0; i < 3; i++) {
+    k[i] = 0;
+    if (!walk->step.xyz[i])
+      continue;
+    int lo = FLOOR_SHR(walk->crl.xyz[i], shift) * size;
+    k[i] = walk->step.xyz[i] > 0 ? lo + size - 1 - walk->crl.xyz[i]
+                                 : walk->crl.xyz[i] - lo;
+    t = MIN(t, walk->t_max.xyz[i] + (float)k[i] * walk->t_delta.xyz[i]);
   }
-  if (fabsf(ty - t) <= eps) {
-    crl->y += (dy < 0.0f) ? -1 : 1;
+  if (t >= walk->len)
+    return false;
+
+  float eps = TIE_EPS(t - walk->t_enter);
+  for (int i = 0; i < 3; i++) {
+    if (!walk->step.xyz[i])
+      continue;
+    // boundaries this axis crosses up to t, at most out of the block
+    int n = 0;
+    if (walk->t_max.xyz[i] <= t + eps) {
+      n = 1 + (int)floorf((t + eps - walk->t_max.xyz[i]) /
+                          walk->t_delta.xyz[i]);
+      n = MIN(n, k[i] + 1);
+    }
+    walk->crl.xyz[i] += n * walk->step.xyz[i];
+    walk->t_max.xyz[i] += (float)n * walk->t_delta.xyz[i];
   }
-  if (fabsf(tz - t) <= eps) {
-    crl->z += (dz < 0.0f) ? -1 : 1;
+  if (walk->len - t < walk->eps) {
+    walk->t_enter = t;
+    return false;
   }
+  GridTr_grid_walk_enter(walk, t);
   return true;
 }
 
-// returns true if cb returns true (early exit)
+bool GridTr_grid_walk_seek_occupied(struct GridTr_grid_walk_s *walk,
+                                    const struct GridTr_grid_s *grid) {
+  for (;;) {
+    struct ivec3_s brick = GridTr_shr_crl(walk->crl, GridTr_BRICK_SHIFT);
+    struct ivec3_s macro = GridTr_shr_crl(brick, 2);
+    if (!iv3eq_(macro, walk->macro_crl)) {
+      walk->macro_crl = macro;
+      walk->macro_mask = GridTr_grid_occ_mask(grid->macro_table, macro);
+    }
+    if (!walk->macro_mask) {
+      if (!GridTr_grid_walk_jump(walk, GridTr_BRICK_SHIFT + 2))
+        return false;
+      continue;
+    }
+    if (!(walk->macro_mask & OCC_BIT(brick))) {
+      if (!GridTr_grid_walk_jump(walk, GridTr_BRICK_SHIFT))
+        return false;
+      continue;
+    }
+    if (!iv3eq_(brick, walk->brick_crl)) {
+      walk->brick_crl = brick;
+      walk->brick_mask = GridTr_grid_occ_mask(grid->brick_table, brick);
+    }
+    if (walk->brick_mask & OCC_BIT(walk->crl))
+      return true;
+    if (!GridTr_grid_walk_step(walk))
+      return false;
+  }
+}
+
 bool GridTr_trace_ray_through_grid(const struct GridTr_grid_s *grid,
                                    const struct GridTr_rayseg_s *rayseg,
                                    GridTr_trace_cb cb, void *user_data) {
+  return GridTr_trace_ray_through_grid_ex(grid, rayseg, 0, cb, user_data);
+}
+
+// returns true if cb returns true (early exit)
+bool GridTr_grid_visit_cells(const struct GridTr_grid_s *grid,
+                             struct ivec3_s crl_min, struct ivec3_s crl_max,
+                             GridTr_cell_cb cb, void *user_data) {
+  return GridTr_grid_visit_cells_culled(grid, crl_min, crl_max, NULL, cb,
+                                        user_data);
+}
+
+bool GridTr_grid_visit_cells_culled(const struct GridTr_grid_s *grid,
+                                    struct ivec3_s crl_min,
+                                    struct ivec3_s crl_max,
+                                    GridTr_block_cb block_cb, GridTr_cell_cb cb,
+                                    void *user_data) {
+  if (!grid || !cb) {
+    printf("<%s> - invalid argument(s)\n", __FUNCTION__);
+    return false;
+  }
+  // nothing outside the occupied bounds, so big ranges over sparse scenes
+  // don't look up every macro cell
+  crl_min = ivec3_max(crl_min, grid->occ_min);
+  crl_max = ivec3_min(crl_max, grid->occ_max);
+  if (crl_min.x > crl_max.x || crl_min.y > crl_max.y || crl_min.z > crl_max.z)
+    return false;
+  struct ivec3_s brick_min = GridTr_shr_crl(crl_min, GridTr_BRICK_SHIFT);
+  struct ivec3_s brick_max = GridTr_shr_crl(crl_max, GridTr_BRICK_SHIFT);
+  struct ivec3_s macro_min = GridTr_shr_crl(brick_min, 2);
+  struct ivec3_s macro_max = GridTr_shr_crl(brick_max, 2);
+  struct ivec3_s m, b, c;
+  for (m.z = macro_min.z; m.z <= macro_max.z; m.z++) {
+    for (m.y = macro_min.y; m.y <= macro_max.y; m.y++) {
+      for (m.x = macro_min.x; m.x <= macro_max.x; m.x++) {
+        uint64 macro_mask = GridTr_grid_occ_mask(grid->macro_table, m);
+        if (!macro_mask)
+          continue;
+        struct GridTr_aabb_s block;
+        if (block_cb) {
+          // a block is a cell of a grid with 4^level times the cell size
+          GridTr_get_aabb_for_grid_cell(m, grid->cell_size * 16.0f, &block);
+          if (!block_cb(&block, user_data))
+            continue;
+        }
+        // bricks of this macro cell inside the range
+        struct ivec3_s lo = ivec3_max(brick_min, ivec3_set(m.x * 4, m.y * 4, m.z * 4));
+        struct ivec3_s hi = ivec3_min(
+            brick_max, ivec3_set(m.x * 4 + 3, m.y * 4 + 3, m.z * 4 + 3));
+        for (b.z = lo.z; b.z <= hi.z; b.z++) {
+          for (b.y = lo.y; b.y <= hi.y; b.y++) {
+            for (b.x = lo.x; b.x <= hi.x; b.x++) {
+              if (!(macro_mask & OCC_BIT(b)))
+                continue;
+              if (block_cb) {
+                GridTr_get_aabb_for_grid_cell(b, grid->cell_size * 4.0f,
+                                              &block);
+                if (!block_cb(&block, user_data))
+                  continue;
+              }
+              uint64 brick_mask = GridTr_grid_occ_mask(grid->brick_table, b);
+              struct ivec3_s clo =
+                  ivec3_max(crl_min, ivec3_set(b.x * 4, b.y * 4, b.z * 4));
+              struct ivec3_s chi = ivec3_min(
+                  crl_max, ivec3_set(b.x * 4 + 3, b.y * 4 + 3, b.z * 4 + 3));
+              for (c.z = clo.z; c.z <= chi.z; c.z++) {
+                for (c.y = clo.y; c.y <= chi.y; c.y++) {
+                  for (c.x = clo.x; c.x <= chi.x; c.x++) {
+                    if (!(brick_mask & OCC_BIT(c)))
+                      continue;
+                    const struct GridTr_grid_cell_s *cell =
+                        GridTr_grid_get_grid_cell_ro(grid, c);
+                    if (cell && cb(cell, user_data))
+                      return true;
+                  }
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+  return false;
+}
+
+bool GridTr_trace_ray_through_grid_ex(const struct GridTr_grid_s *grid,
+                                      const struct GridTr_rayseg_s *rayseg,
+                                      uint32 flags, GridTr_trace_cb cb,
+                                      void *user_data) {
   if (!cb || !grid || !rayseg) {
     printf("<%s> - invalid argument(s)\n", __FUNCTION__);
     return false;
   }
   float eps = grid->cell_size * 1e-5f;
 
-  if (rayseg->len <= eps) {
+  if (rayseg->len <= eps || grid->cell_size <= GridTr_CELL_SIZE_AUTO) {
     return false;
   }
   const struct GridTr_collider_s *colliders = grid->colliders->data;
+  bool skip_empty = (flags & GridTr_TRACE_SKIP_EMPTY) != 0;
 
-  struct vec3_s o = rayseg->o;
-  float remaining = rayseg->len;
-  struct ivec3_s crl = GridTr_get_grid_cell_for_p(rayseg->o, grid->cell_size);
-
-  bool debug = false; // GridTr_debug_enabled();
-  if (debug) {
-    printf("<%s> - begin tracing ray\n", __FUNCTION__);
-  }
-  int steps = 0;
-  while (remaining >= eps) {
-    ++steps;
-    struct GridTr_rayseg_s r = {0};
-    r.o = o;
-    r.d = rayseg->d;
-    r.e = rayseg->e;
-    r.len = remaining;
-    struct ivec3_s crl_next = crl;
-    if (debug) {
-      printf(" --- [%d, %d, %d] (%f remaining)\n", crl.x, crl.y, crl.z,
-             remaining);
-    }
-    bool hit_boundary = GridTr_step_ray_through_grid_cell(grid, &r, &crl_next);
-    if (debug) {
-      printf(" +++ stepped to [%d, %d, %d] (%f len)\n", crl_next.x, crl_next.y,
-             crl_next.z, r.len);
+  struct GridTr_grid_walk_s walk;
+  GridTr_grid_walk_init(&walk, grid, rayseg);
+
+  struct GridTr_rayseg_s r = {0};
+  r.o = rayseg->o;
+  r.d = rayseg->d;
+  do {
+    if (skip_empty) {
+      float t_enter = walk.t_enter;
+      if (!GridTr_grid_walk_seek_occupied(&walk, grid))
+        return false;
+      if (walk.t_enter != t_enter)
+        r.o = vec3_add(rayseg->o, vec3_mul(rayseg->d, walk.t_enter));
     }
+    r.e = walk.last ? rayseg->e
+                    : vec3_add(rayseg->o, vec3_mul(rayseg->d, walk.t_exit));
+    r.len = walk.t_exit - walk.t_enter;
     const struct GridTr_grid_cell_s *cell =
-        GridTr_grid_get_grid_cell_ro(grid, crl);
-    if (cb(cell, crl, &r, colliders, user_data)) {
+        GridTr_grid_get_grid_cell_ro_hint(grid, walk.crl, &walk.cell_hint);
+    if (cb(cell, walk.crl, &r, colliders, user_data)) {
       return true;
     }
-    if (!hit_boundary) {
-      return false;
-    }
-    // float nudge_eps = TIE_EPS(r.len);
-    o = r.e; // vec3_add(r.e, vec3_mul(r.d, nudge_eps));
-    remaining -= r.len;
-    crl = crl_next;
-  }
-  if (debug) {
-    printf("<%s> - finished tracing ray (%d steps)\n", __FUNCTION__, steps);
-  }
+    r.o = r.e;
+  } while (GridTr_grid_walk_step(&walk));
 
   return false;
 }
@@ -2,6 +2,7 @@
 
 #include "collide.h"
 #include "hash.h"
+#include "simd.h"
 
 struct GridTr_grid_cell_s {
   struct ivec3_s crl; // z := layer, y := row, x := column
@@ -10,16 +11,110 @@ struct GridTr_grid_cell_s {
   uint32 *colliders;
   uint32 _max_colliders_;
   struct GridTr_aabb_s aabb;
+  // range in grid->tri_packets, see GridTr_grid_build_tri_packets()
+  uint32 first_tri_packet;
+  uint32 num_tri_packets;
+};
+
+// GridTr_SIMD_WIDTH triangles laid out lane by lane (AoSoA) for the SIMD ray
+// kernel: a cell's polygons fan-triangulated, each triangle kept as its
+// polygon's plane and three edge planes with the tolerance each is tested
+// with. the polygon's own edges keep its edge_planes and TOL, the fan's
+// diagonals are tested exactly by both triangles sharing them (one gets the
+// negated plane), so a polygon hits iff GridTr_rayseg_isect_collider() says
+// it does. idx is the collider, UINT32_MAX in unused lanes
+struct GridTr_tri_packet_s {
+  float nx[GridTr_SIMD_WIDTH], ny[GridTr_SIMD_WIDTH], nz[GridTr_SIMD_WIDTH];
+  float dist[GridTr_SIMD_WIDTH];
+  float enx[3][GridTr_SIMD_WIDTH], eny[3][GridTr_SIMD_WIDTH];
+  float enz[3][GridTr_SIMD_WIDTH], edist[3][GridTr_SIMD_WIDTH];
+  float etol[3][GridTr_SIMD_WIDTH];
+  uint32 idx[GridTr_SIMD_WIDTH];
+};
+
+// coarse occupancy kept alongside cell_table: a brick is a 4x4x4 block of
+// cells and a macro cell a 4x4x4 block of bricks, each with one bit per
+// member that has a cell allocated
+#define GridTr_BRICK_SHIFT 2
+
+struct GridTr_grid_occ_s {
+  struct ivec3_s crl; // brick or macro cell coordinates
+  uint64 mask;
+};
+
+// read-only CSR layout made by GridTr_grid_freeze(): cells sorted by key,
+// the collider indices of cells[i] are indices[offsets[i]..offsets[i+1]) and
+// cells[i].colliders points there. one allocation holds all of it
+struct GridTr_grid_frozen_s {
+  uint32 num_cells;
+  uint32 num_indices;
+  struct GridTr_grid_cell_s *cells;
+  uint64 *keys;
+  uint32 *offsets;
+  uint32 *indices;
+};
+
+// how cells are keyed in cell_table (and ordered once frozen). only frozen
+// grids gain from morton keys: their cells sit in key order, so a walk finds
+// the next cell a few keys from the last (see
+// GridTr_grid_get_grid_cell_ro_hint()). that only shows once the cells
+// outgrow the caches, hashed grids and small scenes trace the same with both
+enum GridTr_cell_key_e {
+  GridTr_CELL_KEY_FNV1A = 0,
+  GridTr_CELL_KEY_MORTON,
+};
+
+// which cells a new collider is SAT tested against. both modes end up with
+// the same cells, they differ in how many get tested: box tests every cell
+// of the collider's bounds grown by one cell each way, voxelize clips the
+// polygon to each layer and row of cells and only tests the run of cells
+// each row's piece spans, which saves most of the tests for large slanted
+// polygons
+enum GridTr_insert_mode_e {
+  GridTr_INSERT_VOXELIZE = 0,
+  GridTr_INSERT_BOX,
 };
 
 struct GridTr_grid_s {
-  struct GridTr_hash_table_s *cell_table;
+  struct GridTr_hash_table_s *cell_table; // NULL once frozen
+  struct GridTr_hash_table_s *brick_table;
+  struct GridTr_hash_table_s *macro_table;
+  // cells that held colliders since the grid was last empty, min > max when
+  // it is. only ever grows otherwise, so it can be loose after removals
+  struct ivec3_s occ_min;
+  struct ivec3_s occ_max;
   struct GridTr_array_s *colliders;
-  uint32 cell_size;
+  struct GridTr_array_s *free_colliders; // removed slots, reused by adds
+  // edges of every stored collider, see GridTr_collider_pool_reserve()
+  struct GridTr_collider_pool_s collider_pool;
+  float cell_size; // GridTr_CELL_SIZE_AUTO until the first build picks one
   struct GridTr_aabb_s aabb;
+  // dense mode (see GridTr_create_grid_dense()): flat x + y*W + z*W*H view of
+  // the cells inside aabb, NULL when sparse. cell_table still owns the cells
+  struct GridTr_grid_cell_s **dense_cells;
+  struct ivec3_s dense_min;
+  struct ivec3_s dense_dims;
+  struct GridTr_grid_frozen_s *frozen;
+  enum GridTr_cell_key_e cell_key;
+  // NULL unless GridTr_grid_build_tri_packets() ran since the last change
+  struct GridTr_tri_packet_s *tri_packets;
+  uint32 num_tri_packets;
+  enum GridTr_insert_mode_e insert_mode; // can change at any time
+};
+
+// upper bound on the dense array, past this the grid stays sparse
+#define GridTr_DENSE_MAX_CELLS (1ull << 26)
+
+// a (cell, collider index) pair produced while classifying colliders, key
+// is the cell's table key
+struct GridTr_cell_ref_s {
+  uint64 key;
+  struct ivec3_s crl;
+  uint32 idx;
 };
 
 void GridTr_grid_cell_dtor(void *ptr);
+void GridTr_grid_occ_dtor(void *ptr);
 struct ivec3_s GridTr_get_grid_cell_for_p(struct vec3_s p, float cell_size);
 void GridTr_get_exts_for_grid_cell(struct ivec3_s crl, float cell_size,
                                    struct vec3_s *min, struct vec3_s *max);
@@ -28,7 +123,42 @@ void GridTr_get_aabb_for_grid_cell(struct ivec3_s crl, float cell_size,
 void GridTr_get_collider_grid_cell_exts(
     const struct GridTr_collider_s *collider, float cell_size,
     struct ivec3_s *crl_min, struct ivec3_s *crl_max, bool bloat);
+// pass as cell_size to GridTr_create_grid() to have the first build pick it
+// with GridTr_suggest_cell_size() for the lowest ray cost. adds are refused
+// until then, and dense grids and mgrids need a real size
+#define GridTr_CELL_SIZE_AUTO 0.0f
+
+enum GridTr_cell_size_goal_e {
+  GridTr_CELL_SIZE_MIN_RAY_COST = 0,
+  GridTr_CELL_SIZE_MEMORY_BUDGET, // lowest ray cost within memory_budget
+};
+
+struct GridTr_cell_size_target_s {
+  enum GridTr_cell_size_goal_e goal;
+  uint64 memory_budget; // bytes of cells + cell lists
+};
+
+// picks a cell size from the colliders' areas, edge lengths and bounds.
+// candidate sizes (multiples of the mean edge length) are scored with a
+// cost model: cells stepped through plus polygons tested by a ray crossing
+// the scene bounds, polygons spread evenly over the bounds. target NULL
+// means GridTr_CELL_SIZE_MIN_RAY_COST
+float GridTr_suggest_cell_size(const struct GridTr_collider_s *colliders,
+                               uint32 num_colliders,
+                               const struct GridTr_cell_size_target_s *target);
+
 void GridTr_create_grid(struct GridTr_grid_s *grid, float cell_size);
+// pick the cell keys, only allowed while the grid has no cells
+bool GridTr_grid_set_cell_key(struct GridTr_grid_s *grid,
+                              enum GridTr_cell_key_e cell_key);
+// morton keys fall back to fnv1a (with bit 63 set) for cells 2^20 or more
+// away from the origin on any axis
+uint64 GridTr_grid_cell_key(const struct GridTr_grid_s *grid,
+                            struct ivec3_s crl);
+// same as GridTr_create_grid() but cells inside bounds are found by array
+// indexing, cells outside of it still go through cell_table
+void GridTr_create_grid_dense(struct GridTr_grid_s *grid, float cell_size,
+                              const struct GridTr_aabb_s *bounds);
 struct GridTr_grid_cell_s *GridTr_grid_get_grid_cell(struct GridTr_grid_s *grid,
                                                      struct ivec3_s crl);
 void GridTr_destroy_grid(struct GridTr_grid_s *grid);
@@ -36,17 +166,95 @@ void GridTr_destroy_grid(struct GridTr_grid_s *grid);
 const struct GridTr_grid_cell_s *
 GridTr_grid_get_grid_cell_ro(const struct GridTr_grid_s *grid,
                              struct ivec3_s crl);
-void GridTr_add_collider_to_grid(struct GridTr_grid_s *grid,
+// same as above, but on a frozen morton keyed grid the search starts from
+// *hint (the index of the previous find). other grids ignore the hint
+const struct GridTr_grid_cell_s *
+GridTr_grid_get_grid_cell_ro_hint(const struct GridTr_grid_s *grid,
+                                  struct ivec3_s crl, uint32 *hint);
+// returns the collider's index, a freed slot if there is one (see
+// GridTr_grid_remove_collider()), UINT32_MAX if it wasn't added (also on a
+// GridTr_CELL_SIZE_AUTO grid that hasn't been built yet)
+uint32 GridTr_add_collider_to_grid(struct GridTr_grid_s *grid,
+                                   const struct GridTr_collider_s *collider);
+
+// takes collider idx out of the cells in its extent, freeing cells that end
+// up empty. the slot stays as a zeroed collider (edge_count 0) so other
+// indices keep their meaning, and the next add reuses it
+bool GridTr_grid_remove_collider(struct GridTr_grid_s *grid, uint32 idx);
+
+// moves / reshapes collider idx in place: unlinks the old footprint and
+// links the new one, the index stays the same
+bool GridTr_grid_update_collider(struct GridTr_grid_s *grid, uint32 idx,
                                  const struct GridTr_collider_s *collider);
 
+// adds many colliders at once: classifies them into (cell, collider) refs,
+// radix sorts the refs by cell key and fills each touched cell's list with
+// a single exactly sized allocation. cell lists come out identical to
+// calling GridTr_add_collider_to_grid() for each collider in order
+void GridTr_build_grid(struct GridTr_grid_s *grid,
+                       const struct GridTr_collider_s *colliders,
+                       uint32 num_colliders);
+
+struct GridTr_thread_pool_s;
+
+// GridTr_build_grid() with the classification spread over pool's workers.
+// the pool is the caller's, so repeated builds don't respawn threads
+void GridTr_build_grid_parallel(struct GridTr_thread_pool_s *pool,
+                                struct GridTr_grid_s *grid,
+                                const struct GridTr_collider_s *colliders,
+                                uint32 num_colliders);
+
 void GridTr_get_colliders_for_cell(const struct GridTr_grid_s *grid,
                                    struct ivec3_s crl, const uint32 *indices,
                                    uint *num_indices,
                                    const struct GridTr_collider_s *colliders);
 
+// cheap check against the brick bitmask, no cell_table lookup
+bool GridTr_grid_cell_occupied(const struct GridTr_grid_s *grid,
+                               struct ivec3_s crl);
+
+// compacts the grid into its frozen layout and drops cell_table. queries
+// keep working, adding colliders is rejected from then on
+bool GridTr_grid_freeze(struct GridTr_grid_s *grid);
+
 const void **GridTr_grid_get_all_grid_cells(const struct GridTr_grid_s *grid,
                                             uint32 *num_cells);
 
+// packs every cell's polygons into GridTr_tri_packet_s blocks, closest hit
+// rays then test a cell a packet at a time instead of polygon by polygon.
+// works on frozen grids too, any add, remove or update drops the packets
+bool GridTr_grid_build_tri_packets(struct GridTr_grid_s *grid);
+
+// incremental (Amanatides-Woo) walk over the cells crossed by a rayseg.
+// all t values are distances from rayseg->o, the current cell spans
+// [t_enter, t_exit] and last is set once t_exit reached the segment end
+struct GridTr_grid_walk_s {
+  struct ivec3_s crl;
+  struct ivec3_s step;
+  struct vec3_s t_max;   // t of the next boundary crossing per axis
+  struct vec3_s t_delta; // t between boundary crossings per axis
+  float t_enter, t_exit;
+  float len;
+  float eps;
+  bool last;
+  // occupancy lookups cached for GridTr_grid_walk_seek_occupied()
+  struct ivec3_s macro_crl, brick_crl;
+  uint64 macro_mask, brick_mask;
+  uint32 cell_hint; // for GridTr_grid_get_grid_cell_ro_hint()
+};
+
+void GridTr_grid_walk_init(struct GridTr_grid_walk_s *walk,
+                           const struct GridTr_grid_s *grid,
+                           const struct GridTr_rayseg_s *rayseg);
+
+// moves to the next cell, returns false once the segment is used up
+bool GridTr_grid_walk_step(struct GridTr_grid_walk_s *walk);
+
+// stays put if the current cell is occupied, otherwise walks on, jumping
+// empty macro cells and bricks whole. returns false if the segment ends first
+bool GridTr_grid_walk_seek_occupied(struct GridTr_grid_walk_s *walk,
+                                    const struct GridTr_grid_s *grid);
+
 // return true if cb wants to exit early
 typedef bool (*GridTr_trace_cb)(const struct GridTr_grid_cell_s *cell,
                                 struct ivec3_s crl,
@@ -54,7 +262,40 @@ typedef bool (*GridTr_trace_cb)(const struct GridTr_grid_cell_s *cell,
                                 const struct GridTr_collider_s *colliders,
                                 void *user_data);
 
-// returns true if cb exited early
+// returns true if cb exited early. cb sees every cell on the way, including
+// empty ones (cell == NULL)
 bool GridTr_trace_ray_through_grid(const struct GridTr_grid_s *grid,
                                    const struct GridTr_rayseg_s *rayseg,
-                                   GridTr_trace_cb cb, void *user_data);
\ No newline at end of file
+                                   GridTr_trace_cb cb, void *user_data);
+
+// return true to exit early
+typedef bool (*GridTr_cell_cb)(const struct GridTr_grid_cell_s *cell,
+                               void *user_data);
+
+// calls cb for every cell with colliders in [crl_min, crl_max] (inclusive),
+// going through the macro and brick masks first, so an empty 16^3 block
+// costs a single lookup. returns true if cb exited early
+bool GridTr_grid_visit_cells(const struct GridTr_grid_s *grid,
+                             struct ivec3_s crl_min, struct ivec3_s crl_max,
+                             GridTr_cell_cb cb, void *user_data);
+
+// return false to skip the block (a macro cell or brick) and all it holds
+typedef bool (*GridTr_block_cb)(const struct GridTr_aabb_s *aabb,
+                                void *user_data);
+
+// same, but block_cb gets to cull each macro cell and brick before it is
+// looked into. block_cb may be NULL
+bool GridTr_grid_visit_cells_culled(const struct GridTr_grid_s *grid,
+                                    struct ivec3_s crl_min,
+                                    struct ivec3_s crl_max,
+                                    GridTr_block_cb block_cb, GridTr_cell_cb cb,
+                                    void *user_data);
+
+// only call cb for cells that have colliders, empty runs are skipped
+// through the occupancy bitmasks
+#define GridTr_TRACE_SKIP_EMPTY 0x1
+
+bool GridTr_trace_ray_through_grid_ex(const struct GridTr_grid_s *grid,
+                                      const struct GridTr_rayseg_s *rayseg,
+                                      uint32 flags, GridTr_trace_cb cb,
+                                      void *user_data);
\ No newline at end of file
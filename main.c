@@ -13,6 +13,10 @@
 // #include "test_geom.h"
 // #include "test_hash.h"
 #include "test_grid.h"
+#include "test_mgrid.h"
+#include "test_packet.h"
+#include "test_pool.h"
+#include "test_query.h"
 
 int g_tests_run = 0;
 int g_tests_failed = 0;
@@ -91,12 +95,16 @@ void test_export() {
 int main(int argc, char *args[]) {
   printf("hello world!\n");
   // run_geom_tests();
-  // run_array_tests();
+  run_array_tests();
   //  run_reuse_array_tests();
   // run_hash_table_tests();
   // run_gc_tests();
-  // run_collide_tests();
+  run_collide_tests();
   run_grid_tests();
+  run_pool_tests();
+  run_query_tests();
+  run_mgrid_tests();
+  run_packet_tests();
   test_export();
 
   GridTr_prmemstats();
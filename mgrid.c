@@ -0,0 +1,242 @@
+#include "mgrid.h"
+#include "vec.inl"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+
+// where each mgrid index lives, kept so lookups by mgrid index stay O(1).
+// level is UINT32_MAX once the collider was removed
+struct GridTr_mgrid_ref_s {
+  uint32 level;
+  uint32 idx;
+};
+
+void GridTr_create_mgrid(struct GridTr_mgrid_s *mgrid, float cell_size,
+                         uint32 ratio, uint32 num_levels) {
+  if (!mgrid) {
+    return;
+  }
+  mgrid->num_colliders = 0;
+  // levels are picked by cell extents, so there is no AUTO here
+  if (!(cell_size > GridTr_CELL_SIZE_AUTO) || isinf(cell_size)) {
+    printf("<%s> - invalid cell size %f\n", __FUNCTION__, cell_size);
+    mgrid->num_levels = 0;
+    mgrid->refs = NULL;
+    return;
+  }
+  mgrid->num_levels = CLAMP(num_levels, 1, GridTr_MGRID_MAX_LEVELS);
+  ratio = MAX(ratio, 2);
+  float size = cell_size;
+  for (uint32 l = 0; l < mgrid->num_levels; l++) {
+    GridTr_create_grid(&mgrid->levels[l], size);
+    mgrid->mgrid_idxs[l] = GridTr_create_array(sizeof(uint32), 256, 256);
+    mgrid->bounds[l].min = vec3_set(FLT_MAX, FLT_MAX, FLT_MAX);
+    mgrid->bounds[l].max = vec3_set(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    size *= (float)ratio;
+  }
+  mgrid->refs = GridTr_create_array(sizeof(struct GridTr_mgrid_ref_s), 256,
+                                    256);
+}
+
+void GridTr_destroy_mgrid(struct GridTr_mgrid_s *mgrid) {
+  if (!mgrid) {
+    return;
+  }
+  for (uint32 l = 0; l < mgrid->num_levels; l++) {
+    GridTr_destroy_grid(&mgrid->levels[l]);
+    GridTr_destroy_array(&mgrid->mgrid_idxs[l]);
+  }
+  GridTr_destroy_array(&mgrid->refs);
+  mgrid->num_levels = 0;
+  mgrid->num_colliders = 0;
+}
+
+uint32 GridTr_mgrid_level_for_collider(const struct GridTr_mgrid_s *mgrid,
+                                       const struct GridTr_collider_s *collider) {
+  for (uint32 l = 0; l + 1 < mgrid->num_levels; l++) {
+    struct ivec3_s crl_min, crl_max;
+    GridTr_get_collider_grid_cell_exts(collider, mgrid->levels[l].cell_size,
+                                       &crl_min, &crl_max, false);
+    struct ivec3_s span = ivec3_sub(crl_max, crl_min);
+    if (MAX(span.x, MAX(span.y, span.z)) <= 1)
+      return l;
+  }
+  return mgrid->num_levels - 1;
+}
+
+static void GridTr_mgrid_add_ref(struct GridTr_mgrid_s *mgrid, uint32 level,
+                                 uint32 idx,
+                                 const struct GridTr_collider_s *collider) {
+  // padded so hits right on the box still reach the level's walk
+  struct vec3_s min, max, pad = vec3_set(TOL, TOL, TOL);
+  GridTr_find_exts(collider->ps, collider->edge_count, &min, &max);
+  struct GridTr_aabb_s *bounds = &mgrid->bounds[level];
+  GridTr_aabb_init(bounds, vec3_min(bounds->min, vec3_sub(min, pad)),
+                   vec3_max(bounds->max, vec3_add(max, pad)));
+  struct GridTr_mgrid_ref_s ref = {level, idx};
+  GridTr_array_add(mgrid->refs, &ref);
+  // a level reuses slots freed by removals, so idx isn't always its last
+  struct GridTr_array_s *mgrid_idxs = mgrid->mgrid_idxs[level];
+  uint32 none = UINT32_MAX;
+  while (mgrid_idxs->num_elems <= idx)
+    GridTr_array_add(mgrid_idxs, &none);
+  *(uint32 *)GridTr_array_get(mgrid_idxs, idx) = mgrid->num_colliders;
+  mgrid->num_colliders++;
+}
+
+uint32 GridTr_add_collider_to_mgrid(struct GridTr_mgrid_s *mgrid,
+                                    const struct GridTr_collider_s *collider) {
+  if (!mgrid || !mgrid->num_levels || !collider) {
+    printf("<%s> - invalid mgrid or collider\n", __FUNCTION__);
+    return UINT32_MAX;
+  }
+  uint32 level = GridTr_mgrid_level_for_collider(mgrid, collider);
+  uint32 idx = GridTr_add_collider_to_grid(&mgrid->levels[level], collider);
+  if (idx == UINT32_MAX)
+    return UINT32_MAX;
+  GridTr_mgrid_add_ref(mgrid, level, idx, collider);
+  return mgrid->num_colliders - 1;
+}
+
+void GridTr_build_mgrid(struct GridTr_mgrid_s *mgrid,
+                        const struct GridTr_collider_s *colliders,
+                        uint32 num_colliders) {
+  if (!mgrid || !mgrid->num_levels || (!colliders && num_colliders)) {
+    printf("<%s> - invalid mgrid or colliders\n", __FUNCTION__);
+    return;
+  }
+  // refs go in before the level builds, so no level may refuse its build
+  for (uint32 l = 0; l < mgrid->num_levels; l++) {
+    if (mgrid->levels[l].frozen) {
+      printf("<%s> - level %u is frozen\n", __FUNCTION__, l);
+      return;
+    }
+  }
+  // gather each level's colliders (shallow copies, the grid copies them)
+  struct GridTr_array_s *buckets[GridTr_MGRID_MAX_LEVELS];
+  for (uint32 l = 0; l < mgrid->num_levels; l++)
+    buckets[l] = GridTr_create_array(sizeof(struct GridTr_collider_s), 256,
+                                     MAX(num_colliders / 4, 256));
+  for (uint32 i = 0; i < num_colliders; i++) {
+    uint32 level = GridTr_mgrid_level_for_collider(mgrid, &colliders[i]);
+    struct GridTr_grid_s *grid = &mgrid->levels[level];
+    GridTr_mgrid_add_ref(mgrid, level,
+                         grid->colliders->num_elems + buckets[level]->num_elems,
+                         &colliders[i]);
+    GridTr_array_add(buckets[level], &colliders[i]);
+  }
+  for (uint32 l = 0; l < mgrid->num_levels; l++) {
+    GridTr_build_grid(&mgrid->levels[l], buckets[l]->data,
+                      buckets[l]->num_elems);
+    GridTr_destroy_array(&buckets[l]);
+  }
+}
+
+bool GridTr_mgrid_remove_collider(struct GridTr_mgrid_s *mgrid, uint32 idx) {
+  struct GridTr_mgrid_ref_s *ref =
+      mgrid ? GridTr_array_get(mgrid->refs, idx) : NULL;
+  if (!ref || ref->level == UINT32_MAX) {
+    printf("<%s> - no collider at %u\n", __FUNCTION__, idx);
+    return false;
+  }
+  if (!GridTr_grid_remove_collider(&mgrid->levels[ref->level], ref->idx))
+    return false;
+  *(uint32 *)GridTr_array_get(mgrid->mgrid_idxs[ref->level], ref->idx) =
+      UINT32_MAX;
+  ref->level = ref->idx = UINT32_MAX;
+  return true;
+}
+
+const struct GridTr_collider_s *
+GridTr_mgrid_get_collider(const struct GridTr_mgrid_s *mgrid, uint32 idx) {
+  if (!mgrid)
+    return NULL;
+  const struct GridTr_mgrid_ref_s *ref = GridTr_array_get_ro(mgrid->refs, idx);
+  if (!ref || ref->level == UINT32_MAX)
+    return NULL;
+  return GridTr_array_get_ro(mgrid->levels[ref->level].colliders, ref->idx);
+}
+
+static bool GridTr_mgrid_seg_reaches_level(const struct GridTr_mgrid_s *mgrid,
+                                           uint32 level,
+                                           const struct GridTr_rayseg_s *seg) {
+  float ts[2];
+  return GridTr_aabb_clip_ray(&mgrid->bounds[level], &seg->ray, ts) &&
+         ts[0] <= seg->len;
+}
+
+bool GridTr_mgrid_raycast_closest(const struct GridTr_mgrid_s *mgrid,
+                                  const struct GridTr_rayseg_s *rayseg,
+                                  struct GridTr_hit_s *hit) {
+  return GridTr_mgrid_raycast_closest_counted(mgrid, rayseg, hit, NULL);
+}
+
+bool GridTr_mgrid_raycast_closest_counted(const struct GridTr_mgrid_s *mgrid,
+                                          const struct GridTr_rayseg_s *rayseg,
+                                          struct GridTr_hit_s *hit,
+                                          uint32 *num_tests) {
+  if (!mgrid || !rayseg || !hit) {
+    printf("<%s> - invalid argument(s)\n", __FUNCTION__);
+    return false;
+  }
+  // levels in the order the ray enters their bounds, finer first on ties. a
+  // coarse cell holds every big polygon across it, so a ray starting in the
+  // clutter would test them all before a close small hit cut its walk. a
+  // ray coming down through big occluders instead stops at them first
+  uint32 order[GridTr_MGRID_MAX_LEVELS];
+  float enter_ts[GridTr_MGRID_MAX_LEVELS];
+  uint32 num_order = 0;
+  for (uint32 l = 0; l < mgrid->num_levels; l++) {
+    float ts[2];
+    if (!mgrid->levels[l].colliders->num_elems ||
+        !GridTr_aabb_clip_ray(&mgrid->bounds[l], &rayseg->ray, ts) ||
+        ts[0] > rayseg->len)
+      continue;
+    uint32 at = num_order++;
+    for (; at > 0 && enter_ts[at - 1] > ts[0]; at--) {
+      order[at] = order[at - 1];
+      enter_ts[at] = enter_ts[at - 1];
+    }
+    order[at] = l;
+    enter_ts[at] = ts[0];
+  }
+  struct GridTr_rayseg_s seg = *rayseg;
+  bool found = false;
+  for (uint32 i = 0; i < num_order; i++) {
+    uint32 l = order[i];
+    const struct GridTr_grid_s *grid = &mgrid->levels[l];
+    // same ray, so its entry t still holds for the shortened segment
+    if (enter_ts[i] > seg.len)
+      break;
+    struct GridTr_hit_s level_hit;
+    if (!GridTr_raycast_closest_counted(grid, &seg, &level_hit, num_tests))
+      continue;
+    if (found && level_hit.t >= hit->t)
+      continue;
+    *hit = level_hit;
+    hit->collider_idx = *(const uint32 *)GridTr_array_get_ro(
+        mgrid->mgrid_idxs[l], level_hit.collider_idx);
+    found = true;
+    // same origin and direction, so t stays comparable across levels
+    seg.e = hit->p;
+    seg.len = hit->t;
+  }
+  return found;
+}
+
+bool GridTr_mgrid_raycast_any(const struct GridTr_mgrid_s *mgrid,
+                              const struct GridTr_rayseg_s *rayseg) {
+  if (!mgrid || !rayseg) {
+    printf("<%s> - invalid argument(s)\n", __FUNCTION__);
+    return false;
+  }
+  for (int l = (int)mgrid->num_levels - 1; l >= 0; l--) {
+    const struct GridTr_grid_s *grid = &mgrid->levels[l];
+    if (grid->colliders->num_elems &&
+        GridTr_mgrid_seg_reaches_level(mgrid, (uint32)l, rayseg) &&
+        GridTr_raycast_any(grid, rayseg))
+      return true;
+  }
+  return false;
+}
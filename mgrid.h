@@ -0,0 +1,66 @@
+#pragma once
+
+#include "query.h"
+
+#define GridTr_MGRID_MAX_LEVELS 8
+
+// a stack of grids, level l has cells of cell_size * ratio^l. each collider
+// lives in exactly one level, the finest one where it spans at most two
+// cells per axis, so big polygons stay out of the fine cells and small
+// clutter stays out of the coarse ones
+struct GridTr_mgrid_s {
+  uint32 num_levels;
+  uint32 num_colliders;
+  struct GridTr_grid_s levels[GridTr_MGRID_MAX_LEVELS];
+  // per level: level collider index -> mgrid collider index
+  struct GridTr_array_s *mgrid_idxs[GridTr_MGRID_MAX_LEVELS];
+  // mgrid collider index -> (level, level collider index)
+  struct GridTr_array_s *refs;
+  // per level: box around every collider added since creation, min > max
+  // while there was none. not shrunk by removals, so it can be loose
+  struct GridTr_aabb_s bounds[GridTr_MGRID_MAX_LEVELS];
+};
+
+// cell_size must be > 0, otherwise the mgrid is left with no levels and
+// refuses adds and builds
+void GridTr_create_mgrid(struct GridTr_mgrid_s *mgrid, float cell_size,
+                         uint32 ratio, uint32 num_levels);
+
+void GridTr_destroy_mgrid(struct GridTr_mgrid_s *mgrid);
+
+// level the collider goes into (colliders too big for all go to the last)
+uint32 GridTr_mgrid_level_for_collider(const struct GridTr_mgrid_s *mgrid,
+                                       const struct GridTr_collider_s *collider);
+
+// returns the collider's mgrid index, colliders are numbered in add order
+uint32 GridTr_add_collider_to_mgrid(struct GridTr_mgrid_s *mgrid,
+                                    const struct GridTr_collider_s *collider);
+
+// buckets the colliders by level and bulk builds each level (see
+// GridTr_build_grid()), numbering them as consecutive adds would
+void GridTr_build_mgrid(struct GridTr_mgrid_s *mgrid,
+                        const struct GridTr_collider_s *colliders,
+                        uint32 num_colliders);
+
+// takes the collider out of its level (see GridTr_grid_remove_collider()).
+// mgrid indices aren't reused, idx stays dead and later adds get new ones
+bool GridTr_mgrid_remove_collider(struct GridTr_mgrid_s *mgrid, uint32 idx);
+
+// NULL for removed colliders
+const struct GridTr_collider_s *
+GridTr_mgrid_get_collider(const struct GridTr_mgrid_s *mgrid, uint32 idx);
+
+// closest hit over all levels, walked in the order the segment enters their
+// bounds, each walk cut short at the best t so far. hit->collider_idx is the
+// mgrid index
+bool GridTr_mgrid_raycast_closest(const struct GridTr_mgrid_s *mgrid,
+                                  const struct GridTr_rayseg_s *rayseg,
+                                  struct GridTr_hit_s *hit);
+// see GridTr_raycast_closest_counted()
+bool GridTr_mgrid_raycast_closest_counted(const struct GridTr_mgrid_s *mgrid,
+                                          const struct GridTr_rayseg_s *rayseg,
+                                          struct GridTr_hit_s *hit,
+                                          uint32 *num_tests);
+
+bool GridTr_mgrid_raycast_any(const struct GridTr_mgrid_s *mgrid,
+                              const struct GridTr_rayseg_s *rayseg);
@@ -0,0 +1,262 @@
+#include "packet.h"
+#include "vec.inl"
+
+#include <stdio.h>
+
+void GridTr_ray_packet_load(struct GridTr_ray_packet_s *packet,
+                            const float *ox, const float *oy, const float *oz,
+                            const float *dx, const float *dy, const float *dz,
+                            const float *len, uint32 n) {
+  n = MIN(n, GridTr_PACKET_SIZE);
+  for (uint32 i = 0; i < GridTr_PACKET_SIZE; i++) {
+    // unused lanes get a harmless zero length ray
+    bool used = i < n;
+    packet->ox[i] = used ? ox[i] : 0.0f;
+    packet->oy[i] = used ? oy[i] : 0.0f;
+    packet->oz[i] = used ? oz[i] : 0.0f;
+    packet->dx[i] = used ? dx[i] : 1.0f;
+    packet->dy[i] = used ? dy[i] : 0.0f;
+    packet->dz[i] = used ? dz[i] : 0.0f;
+    packet->len[i] = used ? len[i] : 0.0f;
+  }
+  packet->num_rays = n;
+}
+
+uint32 GridTr_packet_isect_collider(const struct GridTr_collider_s *collider,
+                                    const struct GridTr_ray_packet_s *packet,
+                                    uint32 lanes, uint32 collider_idx,
+                                    float *t, uint32 *idx) {
+  GridTr_vf ox = GridTr_vf_load(packet->ox);
+  GridTr_vf oy = GridTr_vf_load(packet->oy);
+  GridTr_vf oz = GridTr_vf_load(packet->oz);
+  GridTr_vf dx = GridTr_vf_load(packet->dx);
+  GridTr_vf dy = GridTr_vf_load(packet->dy);
+  GridTr_vf dz = GridTr_vf_load(packet->dz);
+  GridTr_vf nx = GridTr_vf_set1(collider->plane.n.x);
+  GridTr_vf ny = GridTr_vf_set1(collider->plane.n.y);
+  GridTr_vf nz = GridTr_vf_set1(collider->plane.n.z);
+  GridTr_vf tol = GridTr_vf_set1(TOL);
+  GridTr_vf best = GridTr_vf_load(t);
+
+  // same operations as the scalar test, so t comes out the same
+  GridTr_vf denom = GridTr_vf_dot3(dx, dy, dz, nx, ny, nz);
+  GridTr_vf t_ = GridTr_vf_div(
+      GridTr_vf_sub(GridTr_vf_set1(collider->plane.dist),
+                    GridTr_vf_dot3(ox, oy, oz, nx, ny, nz)),
+      denom);
+  GridTr_vf ok = GridTr_vf_le(tol, GridTr_vf_abs(denom));
+  ok = GridTr_vf_and(ok, GridTr_vf_le(GridTr_vf_set1(0.0f), t_));
+  ok = GridTr_vf_and(ok, GridTr_vf_le(t_, GridTr_vf_load(packet->len)));
+  ok = GridTr_vf_and(ok, GridTr_vf_lt(t_, best));
+  if (!(GridTr_vf_movemask(ok) & lanes))
+    return 0;
+
+  GridTr_vf px = GridTr_vf_add(ox, GridTr_vf_mul(dx, t_));
+  GridTr_vf py = GridTr_vf_add(oy, GridTr_vf_mul(dy, t_));
+  GridTr_vf pz = GridTr_vf_add(oz, GridTr_vf_mul(dz, t_));
+  for (uint32 i = 0; i < collider->edge_count; i++) {
+    struct GridTr_plane_s pl = collider->edge_planes[i];
+    GridTr_vf d = GridTr_vf_sub(
+        GridTr_vf_dot3(px, py, pz, GridTr_vf_set1(pl.n.x),
+                       GridTr_vf_set1(pl.n.y), GridTr_vf_set1(pl.n.z)),
+        GridTr_vf_set1(pl.dist));
+    ok = GridTr_vf_and(ok, GridTr_vf_le(d, tol));
+    if (!(GridTr_vf_movemask(ok) & lanes))
+      return 0;
+  }
+
+  uint32 hit = GridTr_vf_movemask(ok) & lanes;
+  _Alignas(GridTr_SIMD_ALIGN) float ts[GridTr_PACKET_SIZE];
+  GridTr_vf_store(ts, t_);
+  for (uint32 i = 0; i < GridTr_PACKET_SIZE; i++) {
+    if (hit & (1u << i)) {
+      t[i] = ts[i];
+      idx[i] = collider_idx;
+    }
+  }
+  return hit;
+}
+
+bool GridTr_tri_packet_isect(const struct GridTr_tri_packet_s *packet,
+                             const struct GridTr_rayseg_s *rayseg,
+                             float *best_t, uint32 *best_idx) {
+  // packets live in plain heap blocks, so no aligned loads
+  GridTr_vf nx = GridTr_vf_loadu(packet->nx);
+  GridTr_vf ny = GridTr_vf_loadu(packet->ny);
+  GridTr_vf nz = GridTr_vf_loadu(packet->nz);
+  GridTr_vf ox = GridTr_vf_set1(rayseg->o.x);
+  GridTr_vf oy = GridTr_vf_set1(rayseg->o.y);
+  GridTr_vf oz = GridTr_vf_set1(rayseg->o.z);
+  GridTr_vf dx = GridTr_vf_set1(rayseg->d.x);
+  GridTr_vf dy = GridTr_vf_set1(rayseg->d.y);
+  GridTr_vf dz = GridTr_vf_set1(rayseg->d.z);
+
+  // same operations as GridTr_rayseg_isect_collider(), so hits and t come
+  // out the same. padding lanes have a zero normal and fail on denom
+  GridTr_vf denom = GridTr_vf_dot3(dx, dy, dz, nx, ny, nz);
+  GridTr_vf ok = GridTr_vf_le(GridTr_vf_set1(TOL), GridTr_vf_abs(denom));
+  if (!GridTr_vf_movemask(ok))
+    return false;
+  GridTr_vf t = GridTr_vf_div(
+      GridTr_vf_sub(GridTr_vf_loadu(packet->dist),
+                    GridTr_vf_dot3(ox, oy, oz, nx, ny, nz)),
+      GridTr_vf_select(ok, denom, GridTr_vf_set1(1.0f)));
+  ok = GridTr_vf_and(ok, GridTr_vf_le(GridTr_vf_set1(0.0f), t));
+  ok = GridTr_vf_and(ok, GridTr_vf_le(t, GridTr_vf_set1(rayseg->len)));
+  ok = GridTr_vf_and(ok, GridTr_vf_lt(t, GridTr_vf_set1(*best_t)));
+  if (!GridTr_vf_movemask(ok))
+    return false;
+
+  GridTr_vf px = GridTr_vf_add(ox, GridTr_vf_mul(dx, t));
+  GridTr_vf py = GridTr_vf_add(oy, GridTr_vf_mul(dy, t));
+  GridTr_vf pz = GridTr_vf_add(oz, GridTr_vf_mul(dz, t));
+  for (int e = 0; e < 3; e++) {
+    GridTr_vf d = GridTr_vf_sub(
+        GridTr_vf_dot3(px, py, pz, GridTr_vf_loadu(packet->enx[e]),
+                       GridTr_vf_loadu(packet->eny[e]),
+                       GridTr_vf_loadu(packet->enz[e])),
+        GridTr_vf_loadu(packet->edist[e]));
+    ok = GridTr_vf_and(ok, GridTr_vf_le(d, GridTr_vf_loadu(packet->etol[e])));
+  }
+  uint32 hit = GridTr_vf_movemask(ok);
+  if (!hit)
+    return false;
+
+  // lowest lane wins ties, as the scalar loop keeps the first polygon
+  _Alignas(GridTr_SIMD_ALIGN) float ts[GridTr_SIMD_WIDTH];
+  GridTr_vf_store(ts, t);
+  for (uint32 i = 0; i < GridTr_SIMD_WIDTH; i++) {
+    if ((hit & (1u << i)) && ts[i] < *best_t) {
+      *best_t = ts[i];
+      *best_idx = packet->idx[i];
+    }
+  }
+  return true;
+}
+
+// like GridTr_mailbox_s, but remembers which lanes tested each id
+struct GridTr_packet_mailbox_s {
+  uint32 ids[GridTr_MAILBOX_SIZE];
+  uint32 lanes[GridTr_MAILBOX_SIZE];
+};
+
+// returns the lanes of lanes that still need to test idx, and marks them
+static uint32 GridTr_packet_mailbox_test_and_set(
+    struct GridTr_packet_mailbox_s *mailbox, uint32 idx, uint32 lanes) {
+  uint32 slot = idx & (GridTr_MAILBOX_SIZE - 1);
+  if (mailbox->ids[slot] != idx) {
+    mailbox->ids[slot] = idx;
+    mailbox->lanes[slot] = lanes;
+    return lanes;
+  }
+  uint32 todo = lanes & ~mailbox->lanes[slot];
+  mailbox->lanes[slot] |= lanes;
+  return todo;
+}
+
+uint32 GridTr_raycast_packet(const struct GridTr_grid_s *grid,
+                             const struct GridTr_ray_packet_s *packet,
+                             struct GridTr_batch_hit_s *hits) {
+  if (!grid || !packet || !hits) {
+    printf("<%s> - invalid argument(s)\n", __FUNCTION__);
+    return 0;
+  }
+  _Alignas(GridTr_SIMD_ALIGN) float best_t[GridTr_PACKET_SIZE];
+  uint32 best_idx[GridTr_PACKET_SIZE];
+  struct GridTr_grid_walk_s walks[GridTr_PACKET_SIZE];
+  uint32 active = 0;
+  for (uint32 i = 0; i < GridTr_PACKET_SIZE; i++) {
+    best_t[i] = FLT_MAX;
+    best_idx[i] = UINT32_MAX;
+  }
+  if (grid->cell_size > GridTr_CELL_SIZE_AUTO) {
+    for (uint32 i = 0; i < packet->num_rays; i++) {
+      struct GridTr_rayseg_s seg;
+      seg.o = vec3_set(packet->ox[i], packet->oy[i], packet->oz[i]);
+      seg.d = vec3_set(packet->dx[i], packet->dy[i], packet->dz[i]);
+      seg.len = packet->len[i];
+      seg.e = vec3_add(seg.o, vec3_mul(seg.d, seg.len));
+      GridTr_grid_walk_init(&walks[i], grid, &seg);
+      if (GridTr_grid_walk_seek_occupied(&walks[i], grid))
+        active |= 1u << i;
+    }
+  }
+  const struct GridTr_collider_s *colliders = grid->colliders->data;
+  struct GridTr_packet_mailbox_s mailbox;
+  for (uint32 i = 0; i < GridTr_MAILBOX_SIZE; i++)
+    mailbox.ids[i] = UINT32_MAX;
+
+  while (active) {
+    // the first active ray leads, everyone in its cell comes along
+    uint32 lead = 0;
+    while (!(active & (1u << lead)))
+      lead++;
+    struct ivec3_s crl = walks[lead].crl;
+    uint32 lanes = 0;
+    for (uint32 i = lead; i < GridTr_PACKET_SIZE; i++) {
+      if ((active & (1u << i)) && walks[i].crl.x == crl.x &&
+          walks[i].crl.y == crl.y && walks[i].crl.z == crl.z)
+        lanes |= 1u << i;
+    }
+
+    const struct GridTr_grid_cell_s *cell =
+        GridTr_grid_get_grid_cell_ro_hint(grid, crl, &walks[lead].cell_hint);
+    for (uint32 j = 0; j < cell->num_colliders; j++) {
+      uint32 idx = cell->colliders[j];
+      uint32 todo = GridTr_packet_mailbox_test_and_set(&mailbox, idx, lanes);
+      if (todo)
+        GridTr_packet_isect_collider(&colliders[idx], packet, todo, idx, best_t,
+                                     best_idx);
+    }
+
+    for (uint32 i = lead; i < GridTr_PACKET_SIZE; i++) {
+      if (!(lanes & (1u << i)))
+        continue;
+      struct GridTr_grid_walk_s *walk = &walks[i];
+      // same exit rule as the single ray walk
+      if ((best_idx[i] != UINT32_MAX && best_t[i] <= walk->t_exit) ||
+          !GridTr_grid_walk_step(walk) ||
+          !GridTr_grid_walk_seek_occupied(walk, grid))
+        active &= ~(1u << i);
+    }
+  }
+
+  uint32 num_hits = 0;
+  for (uint32 i = 0; i < packet->num_rays; i++) {
+    struct GridTr_batch_hit_s *hit = &hits[i];
+    hit->t = best_t[i];
+    hit->collider_idx = best_idx[i];
+    if (best_idx[i] == UINT32_MAX) {
+      hit->n = vec3_zero();
+      continue;
+    }
+    hit->n = colliders[best_idx[i]].plane.n;
+    if (hit->n.x * packet->dx[i] + hit->n.y * packet->dy[i] +
+            hit->n.z * packet->dz[i] >
+        0.0f)
+      hit->n = vec3_mul(hit->n, -1.0f);
+    num_hits++;
+  }
+  return num_hits;
+}
+
+uint32 GridTr_trace_batch_packets(const struct GridTr_grid_s *grid,
+                                  const float *ox, const float *oy,
+                                  const float *oz, const float *dx,
+                                  const float *dy, const float *dz,
+                                  const float *len, uint32 n,
+                                  struct GridTr_batch_hit_s *hits_out) {
+  if (!grid || !ox || !oy || !oz || !dx || !dy || !dz || !len ||
+      (!hits_out && n)) {
+    printf("<%s> - invalid argument(s)\n", __FUNCTION__);
+    return 0;
+  }
+  uint32 num_hits = 0;
+  struct GridTr_ray_packet_s packet;
+  for (uint32 i = 0; i < n; i += GridTr_PACKET_SIZE) {
+    GridTr_ray_packet_load(&packet, ox + i, oy + i, oz + i, dx + i, dy + i,
+                           dz + i, len + i, n - i);
+    num_hits += GridTr_raycast_packet(grid, &packet, hits_out + i);
+  }
+  return num_hits;
+}
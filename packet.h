@@ -0,0 +1,60 @@
+#pragma once
+
+#include "query.h"
+#include "simd.h"
+
+// rays per packet, one per SIMD lane
+#define GridTr_PACKET_SIZE GridTr_SIMD_WIDTH
+
+// up to GridTr_PACKET_SIZE rays as structure of arrays: origins, unit length
+// directions and segment lengths. lanes from num_rays on are ignored
+struct GridTr_ray_packet_s {
+  _Alignas(GridTr_SIMD_ALIGN) float ox[GridTr_PACKET_SIZE];
+  _Alignas(GridTr_SIMD_ALIGN) float oy[GridTr_PACKET_SIZE];
+  _Alignas(GridTr_SIMD_ALIGN) float oz[GridTr_PACKET_SIZE];
+  _Alignas(GridTr_SIMD_ALIGN) float dx[GridTr_PACKET_SIZE];
+  _Alignas(GridTr_SIMD_ALIGN) float dy[GridTr_PACKET_SIZE];
+  _Alignas(GridTr_SIMD_ALIGN) float dz[GridTr_PACKET_SIZE];
+  _Alignas(GridTr_SIMD_ALIGN) float len[GridTr_PACKET_SIZE];
+  uint32 num_rays;
+};
+
+// fills lanes [0, n) from n rays given as arrays (see GridTr_trace_batch()),
+// n is clamped to GridTr_PACKET_SIZE
+void GridTr_ray_packet_load(struct GridTr_ray_packet_s *packet,
+                            const float *ox, const float *oy, const float *oz,
+                            const float *dx, const float *dy, const float *dz,
+                            const float *len, uint32 n);
+
+// GridTr_rayseg_isect_collider() for the lanes set in lanes at once: lanes
+// that hit before their t[lane] get t[lane] and idx[lane] = collider_idx.
+// t must be GridTr_SIMD_ALIGN aligned. returns the lanes that got a new hit
+uint32 GridTr_packet_isect_collider(const struct GridTr_collider_s *collider,
+                                    const struct GridTr_ray_packet_s *packet,
+                                    uint32 lanes, uint32 collider_idx,
+                                    float *t, uint32 *idx);
+
+// one ray against the GridTr_SIMD_WIDTH triangles of a tri packet at once,
+// with the plane and edge tests of GridTr_rayseg_isect_collider(). a
+// triangle hit at 0 <= t <= rayseg->len that beats *best_t sets *best_t and
+// *best_idx. returns whether one did
+bool GridTr_tri_packet_isect(const struct GridTr_tri_packet_s *packet,
+                             const struct GridTr_rayseg_s *rayseg,
+                             float *best_t, uint32 *best_idx);
+
+// closest hit for every ray of the packet, hits[lane] like in
+// GridTr_trace_batch(). each ray runs its own grid walk, but rays standing
+// in the same cell share its lookup and have its polygons tested together;
+// rays that split up are walked apart until they meet again
+uint32 GridTr_raycast_packet(const struct GridTr_grid_s *grid,
+                             const struct GridTr_ray_packet_s *packet,
+                             struct GridTr_batch_hit_s *hits);
+
+// GridTr_trace_batch() with consecutive rays grouped into packets, which
+// pays off when neighbouring rays are coherent (camera or shadow rays)
+uint32 GridTr_trace_batch_packets(const struct GridTr_grid_s *grid,
+                                  const float *ox, const float *oy,
+                                  const float *oz, const float *dx,
+                                  const float *dy, const float *dz,
+                                  const float *len, uint32 n,
+                                  struct GridTr_batch_hit_s *hits_out);
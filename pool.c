@@ -0,0 +1,212 @@
+#include "pool.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+
+struct GridTr_thread_pool_worker_s {
+  struct GridTr_thread_pool_s *pool;
+  uint32 index;
+};
+
+// a worker's share of the current job: the task range [begin, end) packed
+// into one word (begin low, end high) so popping the front and stealing the
+// back are both a single CAS. the word always says exactly which tasks are
+// left, so a stale CAS that happens to succeed is still right. padded to a
+// cache line so owners don't fight over it
+struct GridTr_thread_pool_deque_s {
+  _Atomic uint64 range;
+  char pad[64 - sizeof(uint64)];
+};
+
+#define GridTr_RANGE(begin, end) ((uint64)(begin) | ((uint64)(end) << 32))
+#define GridTr_RANGE_BEGIN(r) ((uint32)(r))
+#define GridTr_RANGE_END(r) ((uint32)((r) >> 32))
+
+struct GridTr_thread_pool_s {
+  pthread_t *threads;
+  struct GridTr_thread_pool_worker_s *workers;
+  uint32 num_threads; // spawned + the caller
+
+  pthread_mutex_t lock;
+  pthread_cond_t wake; // a job was posted (or quit)
+  pthread_cond_t idle; // the last worker finished the job
+  uint64 job_id;
+  uint32 busy;
+  bool quit;
+
+  // current job
+  GridTr_task_func func;
+  void *ctx;
+  uint32 num_tasks;
+  struct GridTr_thread_pool_deque_s *deques; // one per worker
+};
+
+// takes the front task of the worker's own range
+static bool GridTr_thread_pool_pop(struct GridTr_thread_pool_deque_s *deque,
+                                   uint32 *task) {
+  uint64 r = atomic_load(&deque->range);
+  while (GridTr_RANGE_BEGIN(r) < GridTr_RANGE_END(r)) {
+    uint64 next = GridTr_RANGE(GridTr_RANGE_BEGIN(r) + 1, GridTr_RANGE_END(r));
+    if (atomic_compare_exchange_weak(&deque->range, &r, next)) {
+      *task = GridTr_RANGE_BEGIN(r);
+      return true;
+    }
+  }
+  return false;
+}
+
+// moves the back half of a victim's range into the (empty) own range,
+// visiting victims round robin. false once every range is empty
+static bool GridTr_thread_pool_steal(struct GridTr_thread_pool_s *pool,
+                                     uint32 worker) {
+  for (uint32 i = 1; i < pool->num_threads; i++) {
+    struct GridTr_thread_pool_deque_s *victim =
+        &pool->deques[(worker + i) % pool->num_threads];
+    uint64 r = atomic_load(&victim->range);
+    while (GridTr_RANGE_BEGIN(r) < GridTr_RANGE_END(r)) {
+      uint32 begin = GridTr_RANGE_BEGIN(r), end = GridTr_RANGE_END(r);
+      uint32 mid = end - (end - begin + 1) / 2;
+      if (atomic_compare_exchange_weak(&victim->range, &r,
+                                       GridTr_RANGE(begin, mid))) {
+        // nobody touches an empty range, a plain store is enough
+        atomic_store(&pool->deques[worker].range, GridTr_RANGE(mid, end));
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+static void GridTr_thread_pool_work(struct GridTr_thread_pool_s *pool,
+                                    uint32 worker) {
+  struct GridTr_thread_pool_deque_s *deque = &pool->deques[worker];
+  uint32 task;
+  do {
+    while (GridTr_thread_pool_pop(deque, &task))
+      pool->func(pool->ctx, task, worker);
+  } while (GridTr_thread_pool_steal(pool, worker));
+}
+
+static void *GridTr_thread_pool_main(void *arg) {
+  struct GridTr_thread_pool_worker_s *worker = arg;
+  struct GridTr_thread_pool_s *pool = worker->pool;
+  uint64 seen = 0;
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    while (!pool->quit && pool->job_id == seen)
+      pthread_cond_wait(&pool->wake, &pool->lock);
+    if (pool->quit)
+      break;
+    seen = pool->job_id;
+    pthread_mutex_unlock(&pool->lock);
+
+    GridTr_thread_pool_work(pool, worker->index);
+
+    pthread_mutex_lock(&pool->lock);
+    if (--pool->busy == 0)
+      pthread_cond_signal(&pool->idle);
+  }
+  pthread_mutex_unlock(&pool->lock);
+  return NULL;
+}
+
+struct GridTr_thread_pool_s *GridTr_create_thread_pool(uint32 num_threads) {
+  struct GridTr_thread_pool_s *pool =
+      GridTr_new(sizeof(struct GridTr_thread_pool_s));
+  if (!pool)
+    return NULL;
+  pool->num_threads = MAX(num_threads, 1);
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->wake, NULL);
+  pthread_cond_init(&pool->idle, NULL);
+  pool->job_id = 0;
+  pool->busy = 0;
+  pool->quit = false;
+  pool->func = NULL;
+  pool->ctx = NULL;
+  pool->num_tasks = 0;
+  pool->deques = GridTr_new(pool->num_threads *
+                            sizeof(struct GridTr_thread_pool_deque_s));
+  for (uint32 i = 0; i < pool->num_threads; i++)
+    atomic_init(&pool->deques[i].range, 0);
+
+  uint32 num_spawned = pool->num_threads - 1;
+  pool->threads = NULL;
+  pool->workers = NULL;
+  if (num_spawned) {
+    pool->threads = GridTr_new(num_spawned * sizeof(pthread_t));
+    pool->workers =
+        GridTr_new(num_spawned * sizeof(struct GridTr_thread_pool_worker_s));
+  }
+  for (uint32 i = 0; i < num_spawned; i++) {
+    pool->workers[i].pool = pool;
+    pool->workers[i].index = i + 1; // the caller is worker 0
+    if (pthread_create(&pool->threads[i], NULL, GridTr_thread_pool_main,
+                       &pool->workers[i]) != 0) {
+      printf("<%s> - failed to spawn worker %u\n", __FUNCTION__, i + 1);
+      pool->num_threads = i + 1;
+      break;
+    }
+  }
+  return pool;
+}
+
+void GridTr_destroy_thread_pool(struct GridTr_thread_pool_s **pool) {
+  if (!pool || !*pool)
+    return;
+  struct GridTr_thread_pool_s *ptr = *pool;
+  pthread_mutex_lock(&ptr->lock);
+  ptr->quit = true;
+  pthread_cond_broadcast(&ptr->wake);
+  pthread_mutex_unlock(&ptr->lock);
+  for (uint32 i = 0; i + 1 < ptr->num_threads; i++)
+    pthread_join(ptr->threads[i], NULL);
+
+  pthread_cond_destroy(&ptr->idle);
+  pthread_cond_destroy(&ptr->wake);
+  pthread_mutex_destroy(&ptr->lock);
+  GridTr_free(ptr->threads);
+  GridTr_free(ptr->workers);
+  GridTr_free(ptr->deques);
+  GridTr_free(ptr);
+  *pool = NULL;
+}
+
+uint32 GridTr_thread_pool_size(const struct GridTr_thread_pool_s *pool) {
+  return pool ? pool->num_threads : 0;
+}
+
+void GridTr_thread_pool_run(struct GridTr_thread_pool_s *pool,
+                            GridTr_task_func func, void *ctx,
+                            uint32 num_tasks) {
+  if (!pool || !func) {
+    printf("<%s> - invalid argument(s)\n", __FUNCTION__);
+    return;
+  }
+  if (!num_tasks)
+    return;
+
+  pthread_mutex_lock(&pool->lock);
+  pool->func = func;
+  pool->ctx = ctx;
+  pool->num_tasks = num_tasks;
+  // even contiguous shares to start with, stealing evens out the rest
+  for (uint32 i = 0; i < pool->num_threads; i++) {
+    uint32 begin = (uint32)((uint64)num_tasks * i / pool->num_threads);
+    uint32 end = (uint32)((uint64)num_tasks * (i + 1) / pool->num_threads);
+    atomic_store(&pool->deques[i].range, GridTr_RANGE(begin, end));
+  }
+  pool->busy = pool->num_threads - 1;
+  pool->job_id++;
+  pthread_cond_broadcast(&pool->wake);
+  pthread_mutex_unlock(&pool->lock);
+
+  GridTr_thread_pool_work(pool, 0);
+
+  pthread_mutex_lock(&pool->lock);
+  while (pool->busy > 0)
+    pthread_cond_wait(&pool->idle, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
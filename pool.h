@@ -0,0 +1,26 @@
+#pragma once
+
+#include "defs.h"
+
+// persistent worker threads. a job is num_tasks calls of func, spread over
+// the workers and the calling thread; worker is in [0, num_threads) and can
+// index per-thread scratch. each worker starts on its own contiguous share
+// of the tasks and steals half of someone else's leftovers once done, so
+// uneven task costs even out
+typedef void (*GridTr_task_func)(void *ctx, uint32 task, uint32 worker);
+
+struct GridTr_thread_pool_s;
+
+// num_threads counts the calling thread, so num_threads - 1 get spawned
+struct GridTr_thread_pool_s *GridTr_create_thread_pool(uint32 num_threads);
+
+void GridTr_destroy_thread_pool(struct GridTr_thread_pool_s **pool);
+
+uint32 GridTr_thread_pool_size(const struct GridTr_thread_pool_s *pool);
+
+// blocks until every task ran. one run per pool at a time: the job lives
+// in the pool and the caller works as thread 0, so never call this from
+// two threads at once or from inside one of the pool's own tasks
+void GridTr_thread_pool_run(struct GridTr_thread_pool_s *pool,
+                            GridTr_task_func func, void *ctx,
+                            uint32 num_tasks);
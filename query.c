@@ -0,0 +1,695 @@
+#include "query.h"
+#include "packet.h"
+#include "pool.h"
+#include "vec.inl"
+
+#include <math.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+
+// num_tests may be NULL
+static bool GridTr_raycast_closest_(const struct GridTr_grid_s *grid,
+                                    const struct GridTr_rayseg_s *rayseg,
+                                    float *best_t, uint32 *best_idx,
+                                    uint32 *num_tests) {
+  const struct GridTr_collider_s *colliders = grid->colliders->data;
+  struct GridTr_mailbox_s mailbox;
+  GridTr_mailbox_clear(&mailbox);
+  *best_t = FLT_MAX;
+  *best_idx = UINT32_MAX;
+
+  struct GridTr_grid_walk_s walk;
+  GridTr_grid_walk_init(&walk, grid, rayseg);
+  while (GridTr_grid_walk_seek_occupied(&walk, grid)) {
+    const struct GridTr_grid_cell_s *cell =
+        GridTr_grid_get_grid_cell_ro_hint(grid, walk.crl, &walk.cell_hint);
+    if (grid->tri_packets) {
+      // a polygon seen again in a later cell can't win twice, no mailbox
+      const struct GridTr_tri_packet_s *packets =
+          &grid->tri_packets[cell->first_tri_packet];
+      for (uint32 i = 0; i < cell->num_tri_packets; i++)
+        GridTr_tri_packet_isect(&packets[i], rayseg, best_t, best_idx);
+      if (num_tests)
+        *num_tests += cell->num_tri_packets;
+    } else {
+      for (uint32 i = 0; i < cell->num_colliders; i++) {
+        uint32 idx = cell->colliders[i];
+        if (!GridTr_mailbox_test_and_set(&mailbox, idx))
+          continue;
+        if (num_tests)
+          (*num_tests)++;
+        float t;
+        // test against the whole segment so t is comparable across cells
+        if (GridTr_rayseg_isect_collider(&colliders[idx], rayseg, &t) &&
+            t < *best_t) {
+          *best_t = t;
+          *best_idx = idx;
+        }
+      }
+    }
+    // nothing in a later cell can beat a hit that lands before this exit
+    if (*best_idx != UINT32_MAX && *best_t <= walk.t_exit)
+      break;
+    if (!GridTr_grid_walk_step(&walk))
+      break;
+  }
+  return *best_idx != UINT32_MAX;
+}
+
+bool GridTr_raycast_closest(const struct GridTr_grid_s *grid,
+                            const struct GridTr_rayseg_s *rayseg,
+                            struct GridTr_hit_s *hit) {
+  return GridTr_raycast_closest_counted(grid, rayseg, hit, NULL);
+}
+
+bool GridTr_raycast_closest_counted(const struct GridTr_grid_s *grid,
+                                    const struct GridTr_rayseg_s *rayseg,
+                                    struct GridTr_hit_s *hit,
+                                    uint32 *num_tests) {
+  if (!grid || !rayseg || !hit) {
+    printf("<%s> - invalid argument(s)\n", __FUNCTION__);
+    return false;
+  }
+  float best_t;
+  uint32 best_idx;
+  if (grid->cell_size <= GridTr_CELL_SIZE_AUTO ||
+      !GridTr_raycast_closest_(grid, rayseg, &best_t, &best_idx, num_tests))
+    return false;
+
+  const struct GridTr_collider_s *collider =
+      GridTr_array_get_ro(grid->colliders, best_idx);
+  hit->t = best_t;
+  hit->collider_idx = best_idx;
+  hit->p = vec3_add(rayseg->o, vec3_mul(rayseg->d, best_t));
+  hit->n = collider->plane.n;
+  if (vec3_dot(hit->n, rayseg->d) > 0.0f)
+    hit->n = vec3_mul(hit->n, -1.0f);
+  return true;
+}
+
+struct GridTr_trace_batch_s {
+  const struct GridTr_grid_s *grid;
+  const float *ox, *oy, *oz;
+  const float *dx, *dy, *dz;
+  const float *len;
+  uint32 n;
+  struct GridTr_batch_hit_s *hits_out;
+  atomic_uint num_hits;
+};
+
+// rays [begin, end) of the batch, returns how many hit
+static uint32 GridTr_trace_batch_(const struct GridTr_trace_batch_s *b,
+                                  uint32 begin, uint32 end) {
+  const struct GridTr_collider_s *colliders = b->grid->colliders->data;
+  uint32 num_hits = 0;
+  for (uint32 i = begin; i < end; i++) {
+    // directions are unit already, so no GridTr_create_rayseg()
+    struct GridTr_rayseg_s seg;
+    seg.o = vec3_set(b->ox[i], b->oy[i], b->oz[i]);
+    seg.d = vec3_set(b->dx[i], b->dy[i], b->dz[i]);
+    seg.len = b->len[i];
+    seg.e = vec3_add(seg.o, vec3_mul(seg.d, seg.len));
+    struct GridTr_batch_hit_s *hit = &b->hits_out[i];
+    if (!GridTr_raycast_closest_(b->grid, &seg, &hit->t, &hit->collider_idx,
+                                 NULL)) {
+      hit->n = vec3_zero();
+      continue;
+    }
+    hit->n = colliders[hit->collider_idx].plane.n;
+    if (vec3_dot(hit->n, seg.d) > 0.0f)
+      hit->n = vec3_mul(hit->n, -1.0f);
+    num_hits++;
+  }
+  return num_hits;
+}
+
+static bool GridTr_trace_batch_init(struct GridTr_trace_batch_s *b,
+                                    const struct GridTr_grid_s *grid,
+                                    const float *ox, const float *oy,
+                                    const float *oz, const float *dx,
+                                    const float *dy, const float *dz,
+                                    const float *len, uint32 n,
+                                    struct GridTr_batch_hit_s *hits_out) {
+  if (!grid || !ox || !oy || !oz || !dx || !dy || !dz || !len ||
+      (!hits_out && n))
+    return false;
+  b->grid = grid;
+  b->ox = ox, b->oy = oy, b->oz = oz;
+  b->dx = dx, b->dy = dy, b->dz = dz;
+  b->len = len;
+  b->n = n;
+  b->hits_out = hits_out;
+  atomic_init(&b->num_hits, 0);
+  if (grid->cell_size <= GridTr_CELL_SIZE_AUTO) {
+    for (uint32 i = 0; i < n; i++) {
+      hits_out[i].t = FLT_MAX;
+      hits_out[i].collider_idx = UINT32_MAX;
+      hits_out[i].n = vec3_zero();
+    }
+    b->n = 0;
+  }
+  return true;
+}
+
+uint32 GridTr_trace_batch(const struct GridTr_grid_s *grid, const float *ox,
+                          const float *oy, const float *oz, const float *dx,
+                          const float *dy, const float *dz, const float *len,
+                          uint32 n, struct GridTr_batch_hit_s *hits_out) {
+  struct GridTr_trace_batch_s b;
+  if (!GridTr_trace_batch_init(&b, grid, ox, oy, oz, dx, dy, dz, len, n,
+                               hits_out)) {
+    printf("<%s> - invalid argument(s)\n", __FUNCTION__);
+    return 0;
+  }
+  return GridTr_trace_batch_(&b, 0, b.n);
+}
+
+static void GridTr_trace_batch_task(void *ctx, uint32 task, uint32 worker) {
+  (void)worker;
+  struct GridTr_trace_batch_s *b = ctx;
+  uint32 begin = task * GridTr_TRACE_BATCH_CHUNK;
+  uint32 end = MIN(begin + GridTr_TRACE_BATCH_CHUNK, b->n);
+  atomic_fetch_add(&b->num_hits, GridTr_trace_batch_(b, begin, end));
+}
+
+uint32 GridTr_trace_batch_parallel(struct GridTr_thread_pool_s *pool,
+                                   const struct GridTr_grid_s *grid,
+                                   const float *ox, const float *oy,
+                                   const float *oz, const float *dx,
+                                   const float *dy, const float *dz,
+                                   const float *len, uint32 n,
+                                   struct GridTr_batch_hit_s *hits_out) {
+  struct GridTr_trace_batch_s b;
+  if (!pool || !GridTr_trace_batch_init(&b, grid, ox, oy, oz, dx, dy, dz, len,
+                                        n, hits_out)) {
+    printf("<%s> - invalid argument(s)\n", __FUNCTION__);
+    return 0;
+  }
+  uint32 num_tasks =
+      (b.n + GridTr_TRACE_BATCH_CHUNK - 1) / GridTr_TRACE_BATCH_CHUNK;
+  GridTr_thread_pool_run(pool, GridTr_trace_batch_task, &b, num_tasks);
+  return atomic_load(&b.num_hits);
+}
+
+bool GridTr_raycast_any(const struct GridTr_grid_s *grid,
+                        const struct GridTr_rayseg_s *rayseg) {
+  if (!grid || !rayseg) {
+    printf("<%s> - invalid argument(s)\n", __FUNCTION__);
+    return false;
+  }
+  if (grid->cell_size <= GridTr_CELL_SIZE_AUTO)
+    return false; // auto sized and still empty
+  const struct GridTr_collider_s *colliders = grid->colliders->data;
+  struct GridTr_mailbox_s mailbox;
+  GridTr_mailbox_clear(&mailbox);
+
+  struct GridTr_grid_walk_s walk;
+  GridTr_grid_walk_init(&walk, grid, rayseg);
+  while (GridTr_grid_walk_seek_occupied(&walk, grid)) {
+    const struct GridTr_grid_cell_s *cell =
+        GridTr_grid_get_grid_cell_ro_hint(grid, walk.crl, &walk.cell_hint);
+    for (uint32 i = 0; i < cell->num_colliders; i++) {
+      uint32 idx = cell->colliders[i];
+      if (!GridTr_mailbox_test_and_set(&mailbox, idx))
+        continue;
+      if (GridTr_rayseg_crosses_collider(&colliders[idx], rayseg))
+        return true;
+    }
+    if (!GridTr_grid_walk_step(&walk))
+      break;
+  }
+  return false;
+}
+
+uint32 GridTr_raycast_all(const struct GridTr_grid_s *grid,
+                          const struct GridTr_rayseg_s *rayseg,
+                          struct GridTr_hit_s *hits, uint32 max_hits) {
+  if (!grid || !rayseg || (!hits && max_hits)) {
+    printf("<%s> - invalid argument(s)\n", __FUNCTION__);
+    return 0;
+  }
+  if (grid->cell_size <= GridTr_CELL_SIZE_AUTO || !max_hits)
+    return 0;
+  const struct GridTr_collider_s *colliders = grid->colliders->data;
+  // holds misses and emitted hits, both can be skipped from then on. an
+  // eviction only costs a retest: emitted hits fall before the window again
+  struct GridTr_mailbox_s mailbox;
+  GridTr_mailbox_clear(&mailbox);
+  uint32 num_hits = 0;
+
+  // each cell owns the hits in (t_min, t_max], the windows don't overlap so
+  // a polygon straddling cells is emitted once, and in t order
+  float t_min = -FLT_MAX;
+  struct GridTr_grid_walk_s walk;
+  GridTr_grid_walk_init(&walk, grid, rayseg);
+  while (GridTr_grid_walk_seek_occupied(&walk, grid)) {
+    float t_max = walk.last ? FLT_MAX : walk.t_exit + walk.eps;
+    uint32 first = num_hits;
+    const struct GridTr_grid_cell_s *cell =
+        GridTr_grid_get_grid_cell_ro_hint(grid, walk.crl, &walk.cell_hint);
+    for (uint32 i = 0; i < cell->num_colliders; i++) {
+      uint32 idx = cell->colliders[i];
+      if (GridTr_mailbox_has(&mailbox, idx))
+        continue;
+      float t;
+      bool isect = GridTr_rayseg_isect_collider(&colliders[idx], rayseg, &t);
+      if (isect && t > t_max)
+        continue; // a later cell has it
+      GridTr_mailbox_test_and_set(&mailbox, idx);
+      if (!isect || t <= t_min)
+        continue;
+      // insertion sort into this cell's run, dropping the furthest if full
+      uint32 j = num_hits;
+      if (num_hits == max_hits) {
+        if (first == max_hits || hits[max_hits - 1].t <= t)
+          continue;
+        j = max_hits - 1;
+      } else {
+        num_hits++;
+      }
+      for (; j > first && hits[j - 1].t > t; j--)
+        hits[j] = hits[j - 1];
+      struct GridTr_hit_s *hit = &hits[j];
+      hit->t = t;
+      hit->collider_idx = idx;
+      hit->p = vec3_add(rayseg->o, vec3_mul(rayseg->d, t));
+      hit->n = colliders[idx].plane.n;
+      if (vec3_dot(hit->n, rayseg->d) > 0.0f)
+        hit->n = vec3_mul(hit->n, -1.0f);
+    }
+    // later cells only have further hits
+    if (num_hits == max_hits)
+      break;
+    t_min = t_max;
+    if (!GridTr_grid_walk_step(&walk))
+      break;
+  }
+  return num_hits;
+}
+
+struct GridTr_spherecast_s {
+  const struct GridTr_collider_s *colliders;
+  const struct GridTr_rayseg_s *seg;
+  float radius;
+  struct GridTr_mailbox_s mailbox;
+  float best_t;
+  uint32 best_idx;
+  struct vec3_s best_n;
+};
+
+static bool GridTr_spherecast_cell(const struct GridTr_grid_cell_s *cell,
+                                   void *user_data) {
+  struct GridTr_spherecast_s *q = user_data;
+  for (uint32 i = 0; i < cell->num_colliders; i++) {
+    uint32 idx = cell->colliders[i];
+    if (!GridTr_mailbox_test_and_set(&q->mailbox, idx))
+      continue;
+    float t;
+    struct vec3_s n;
+    if (GridTr_sweep_sphere_collider(&q->colliders[idx], q->seg, q->radius,
+                                     &t, &n) &&
+        t < q->best_t) {
+      q->best_t = t;
+      q->best_idx = idx;
+      q->best_n = n;
+    }
+  }
+  return false;
+}
+
+bool GridTr_spherecast(const struct GridTr_grid_s *grid,
+                       const struct GridTr_sphere_s *sphere, struct vec3_s to,
+                       struct GridTr_hit_s *hit) {
+  if (!grid || !sphere || !hit || sphere->radius < 0.0f) {
+    printf("<%s> - invalid argument(s)\n", __FUNCTION__);
+    return false;
+  }
+  if (grid->cell_size <= GridTr_CELL_SIZE_AUTO)
+    return false;
+  struct GridTr_rayseg_s seg = GridTr_create_rayseg(sphere->c, to);
+  struct GridTr_spherecast_s q;
+  q.colliders = grid->colliders->data;
+  q.seg = &seg;
+  q.radius = sphere->radius;
+  GridTr_mailbox_clear(&q.mailbox);
+  q.best_t = FLT_MAX;
+  q.best_idx = UINT32_MAX;
+  q.best_n = vec3_zero();
+
+  // walk the centerline and look at every cell within the radius of the
+  // current one. a contact at t is within radius of the center at t, so it
+  // shows up around the cell the center is in by then
+  int k = (int)ceilf(sphere->radius / grid->cell_size);
+  struct ivec3_s kk = ivec3_set(k, k, k);
+  struct GridTr_grid_walk_s walk;
+  GridTr_grid_walk_init(&walk, grid, &seg);
+  struct ivec3_s lo = ivec3_sub(walk.crl, kk);
+  struct ivec3_s hi = ivec3_add(walk.crl, kk);
+  GridTr_grid_visit_cells(grid, lo, hi, GridTr_spherecast_cell, &q);
+  while (GridTr_grid_walk_step(&walk)) {
+    if (walk.t_enter > q.best_t)
+      break;
+    // the box only takes in a layer per axis it moved along: visit those,
+    // each cut down to the old box on the axes before it so no cell is
+    // visited twice
+    struct ivec3_s new_lo = ivec3_sub(walk.crl, kk);
+    struct ivec3_s new_hi = ivec3_add(walk.crl, kk);
+    struct ivec3_s slab_lo = new_lo, slab_hi = new_hi;
+    for (int i = 0; i < 3; i++) {
+      if (new_lo.xyz[i] == lo.xyz[i])
+        continue;
+      if (new_lo.xyz[i] > lo.xyz[i])
+        slab_lo.xyz[i] = MAX(hi.xyz[i] + 1, new_lo.xyz[i]);
+      else
+        slab_hi.xyz[i] = MIN(lo.xyz[i] - 1, new_hi.xyz[i]);
+      GridTr_grid_visit_cells(grid, slab_lo, slab_hi, GridTr_spherecast_cell,
+                              &q);
+      slab_lo.xyz[i] = MAX(lo.xyz[i], new_lo.xyz[i]);
+      slab_hi.xyz[i] = MIN(hi.xyz[i], new_hi.xyz[i]);
+    }
+    lo = new_lo;
+    hi = new_hi;
+  }
+  if (q.best_idx == UINT32_MAX)
+    return false;
+
+  hit->t = q.best_t;
+  hit->collider_idx = q.best_idx;
+  hit->n = q.best_n;
+  hit->p = vec3_sub(vec3_add(seg.o, vec3_mul(seg.d, q.best_t)),
+                    vec3_mul(q.best_n, sphere->radius));
+  return true;
+}
+
+struct GridTr_query_frustum_s {
+  const struct GridTr_frustum_s *frustum;
+  const struct GridTr_collider_s *colliders;
+  struct GridTr_visit_set_s *visited;
+  uint32 *out;
+  uint32 max;
+  uint32 count;
+};
+
+static bool GridTr_query_frustum_block(const struct GridTr_aabb_s *aabb,
+                                       void *user_data) {
+  struct GridTr_query_frustum_s *q = user_data;
+  return !GridTr_frustum_culls_aabb(q->frustum, aabb);
+}
+
+static bool GridTr_query_frustum_cell(const struct GridTr_grid_cell_s *cell,
+                                      void *user_data) {
+  struct GridTr_query_frustum_s *q = user_data;
+  if (GridTr_frustum_culls_aabb(q->frustum, &cell->aabb))
+    return false;
+  for (uint32 i = 0; i < cell->num_colliders; i++) {
+    uint32 idx = cell->colliders[i];
+    if (!GridTr_visit_set_test_and_set(q->visited, idx))
+      continue;
+    if (!GridTr_collider_touches_frustum(&q->colliders[idx], q->frustum))
+      continue;
+    if (q->count < q->max)
+      q->out[q->count] = idx;
+    q->count++;
+  }
+  return false;
+}
+
+uint32 GridTr_grid_query_frustum(const struct GridTr_grid_s *grid,
+                                 const struct GridTr_plane_s *planes,
+                                 struct GridTr_visit_set_s *visited,
+                                 uint32 *out, uint32 max) {
+  if (!grid || !planes || !visited || (!out && max)) {
+    printf("<%s> - invalid argument(s)\n", __FUNCTION__);
+    return 0;
+  }
+  struct GridTr_frustum_s frustum;
+  if (!GridTr_frustum_init(&frustum, planes)) {
+    printf("<%s> - planes don't form a frustum\n", __FUNCTION__);
+    return 0;
+  }
+  if (grid->cell_size <= GridTr_CELL_SIZE_AUTO)
+    return 0;
+  struct GridTr_query_frustum_s q = {&frustum, grid->colliders->data, visited,
+                                     out,      max,                   0};
+  struct vec3_s min, max_p;
+  GridTr_find_exts(frustum.ps, 8, &min, &max_p);
+  GridTr_visit_set_begin(visited, grid->colliders->num_elems);
+  GridTr_grid_visit_cells_culled(
+      grid, GridTr_get_grid_cell_for_p(min, grid->cell_size),
+      GridTr_get_grid_cell_for_p(max_p, grid->cell_size),
+      GridTr_query_frustum_block, GridTr_query_frustum_cell, &q);
+  return q.count;
+}
+
+struct GridTr_closest_point_s {
+  struct vec3_s p;
+  const struct GridTr_collider_s *colliders;
+  struct GridTr_mailbox_s mailbox;
+  float best_d_sq;
+  uint32 best_idx;
+  struct vec3_s best_q;
+};
+
+static bool GridTr_closest_point_cell(const struct GridTr_grid_cell_s *cell,
+                                      void *user_data) {
+  struct GridTr_closest_point_s *q = user_data;
+  // nothing in a cell can be closer than the cell itself
+  float d_sq = 0.0f;
+  for (int i = 0; i < 3; i++) {
+    float d = MAX(cell->aabb.min.xyz[i] - q->p.xyz[i],
+                  q->p.xyz[i] - cell->aabb.max.xyz[i]);
+    d_sq += d > 0.0f ? SQ(d) : 0.0f;
+  }
+  if (d_sq >= q->best_d_sq)
+    return false;
+  for (uint32 i = 0; i < cell->num_colliders; i++) {
+    uint32 idx = cell->colliders[i];
+    if (!GridTr_mailbox_test_and_set(&q->mailbox, idx))
+      continue;
+    struct vec3_s c = GridTr_collider_closest_point(&q->colliders[idx], q->p);
+    d_sq = vec3_lensq(point_vec(c, q->p));
+    if (d_sq < q->best_d_sq) {
+      q->best_d_sq = d_sq;
+      q->best_idx = idx;
+      q->best_q = c;
+    }
+  }
+  return false;
+}
+
+bool GridTr_grid_closest_point(const struct GridTr_grid_s *grid,
+                               struct vec3_s p, float max_dist,
+                               struct GridTr_hit_s *hit) {
+  if (!grid || !hit || !(max_dist >= 0.0f) || isinf(max_dist)) {
+    printf("<%s> - invalid argument(s)\n", __FUNCTION__);
+    return false;
+  }
+  if (grid->cell_size <= GridTr_CELL_SIZE_AUTO)
+    return false;
+  struct GridTr_closest_point_s q;
+  q.p = p;
+  q.colliders = grid->colliders->data;
+  GridTr_mailbox_clear(&q.mailbox);
+  // strictly closer than this, so max_dist itself still counts
+  q.best_d_sq = nextafterf(SQ(max_dist), FLT_MAX);
+  q.best_idx = UINT32_MAX;
+
+  // shell k is the cells k steps (chebyshev) away from p's cell. none of
+  // them is closer than k - 1 cells plus p's distance to its own cell's
+  // nearest face, so once the best is within that the search is over
+  float cs = grid->cell_size;
+  struct ivec3_s c = GridTr_get_grid_cell_for_p(p, cs);
+  struct vec3_s min, max;
+  GridTr_get_exts_for_grid_cell(c, cs, &min, &max);
+  float face_d = FLT_MAX;
+  for (int i = 0; i < 3; i++) {
+    face_d = MIN(face_d, p.xyz[i] - min.xyz[i]);
+    face_d = MIN(face_d, max.xyz[i] - p.xyz[i]);
+  }
+  face_d = MAX(face_d, 0.0f);
+  GridTr_grid_visit_cells(grid, c, c, GridTr_closest_point_cell, &q);
+  for (int k = 1;; k++) {
+    float shell_d = (float)(k - 1) * cs + face_d;
+    if (SQ(shell_d) >= q.best_d_sq)
+      break;
+    // once the shells so far cover the occupied bounds the rest are empty,
+    // which ends misses early
+    bool covered = true;
+    for (int i = 0; i < 3; i++) {
+      covered = covered && grid->occ_min.xyz[i] >= c.xyz[i] - (k - 1) &&
+                grid->occ_max.xyz[i] <= c.xyz[i] + (k - 1);
+    }
+    if (covered)
+      break;
+    // the shell as six slabs: x faces whole, y faces without the x rims,
+    // z faces without either
+    struct ivec3_s lo = ivec3_sub(c, ivec3_set(k, k, k));
+    struct ivec3_s hi = ivec3_add(c, ivec3_set(k, k, k));
+    struct ivec3_s in_lo = ivec3_add(lo, ivec3_set(1, 1, 1));
+    struct ivec3_s in_hi = ivec3_sub(hi, ivec3_set(1, 1, 1));
+    struct ivec3_s slabs[6][2] = {
+        {lo, ivec3_set(lo.x, hi.y, hi.z)},
+        {ivec3_set(hi.x, lo.y, lo.z), hi},
+        {ivec3_set(in_lo.x, lo.y, lo.z), ivec3_set(in_hi.x, lo.y, hi.z)},
+        {ivec3_set(in_lo.x, hi.y, lo.z), ivec3_set(in_hi.x, hi.y, hi.z)},
+        {ivec3_set(in_lo.x, in_lo.y, lo.z), ivec3_set(in_hi.x, in_hi.y, lo.z)},
+        {ivec3_set(in_lo.x, in_lo.y, hi.z), ivec3_set(in_hi.x, in_hi.y, hi.z)},
+    };
+    for (int i = 0; i < 6; i++) {
+      GridTr_grid_visit_cells(grid, slabs[i][0], slabs[i][1],
+                              GridTr_closest_point_cell, &q);
+    }
+  }
+  if (q.best_idx == UINT32_MAX)
+    return false;
+
+  hit->t = sqrtf(q.best_d_sq);
+  hit->collider_idx = q.best_idx;
+  hit->p = q.best_q;
+  // towards p, or the plane normal facing p when p is on the polygon
+  struct vec3_s v = point_vec(q.best_q, p);
+  if (hit->t > TOL) {
+    hit->n = vec3_mul(v, 1.0f / hit->t);
+  } else {
+    const struct GridTr_collider_s *collider = &q.colliders[q.best_idx];
+    hit->n = collider->plane.n;
+    if (eval_plane(collider->plane, p) < 0.0f)
+      hit->n = vec3_mul(hit->n, -1.0f);
+  }
+  return true;
+}
+
+void GridTr_create_visit_set(struct GridTr_visit_set_s *set) {
+  if (!set)
+    return;
+  set->stamps = NULL;
+  set->max_stamps = 0;
+  set->generation = 0;
+}
+
+void GridTr_destroy_visit_set(struct GridTr_visit_set_s *set) {
+  if (!set)
+    return;
+  GridTr_free(set->stamps);
+  set->max_stamps = 0;
+}
+
+void GridTr_visit_set_begin(struct GridTr_visit_set_s *set,
+                            uint32 num_colliders) {
+  if (num_colliders > set->max_stamps) {
+    GridTr_free(set->stamps);
+    set->max_stamps = MAX(num_colliders, set->max_stamps * 2);
+    set->stamps = GridTr_new(set->max_stamps * sizeof(uint32));
+    memset(set->stamps, 0, set->max_stamps * sizeof(uint32));
+    set->generation = 0;
+  }
+  if (++set->generation == 0) {
+    // wrapped, old stamps could match again
+    memset(set->stamps, 0, set->max_stamps * sizeof(uint32));
+    set->generation = 1;
+  }
+}
+
+struct GridTr_query_aabb_s {
+  const struct GridTr_aabb_s *aabb;
+  const struct GridTr_collider_s *colliders;
+  struct GridTr_visit_set_s *visited;
+  uint32 *out;
+  uint32 max;
+  uint32 count;
+};
+
+static bool GridTr_query_aabb_cell(const struct GridTr_grid_cell_s *cell,
+                                   void *user_data) {
+  struct GridTr_query_aabb_s *q = user_data;
+  for (uint32 i = 0; i < cell->num_colliders; i++) {
+    uint32 idx = cell->colliders[i];
+    if (!GridTr_visit_set_test_and_set(q->visited, idx))
+      continue;
+    if (!GridTr_collider_touches_aabb(&q->colliders[idx], q->aabb))
+      continue;
+    if (q->count < q->max)
+      q->out[q->count] = idx;
+    q->count++;
+  }
+  return false;
+}
+
+uint32 GridTr_grid_query_aabb(const struct GridTr_grid_s *grid,
+                              const struct GridTr_aabb_s *aabb,
+                              struct GridTr_visit_set_s *visited, uint32 *out,
+                              uint32 max) {
+  if (!grid || !aabb || !visited || (!out && max)) {
+    printf("<%s> - invalid argument(s)\n", __FUNCTION__);
+    return 0;
+  }
+  if (grid->cell_size <= GridTr_CELL_SIZE_AUTO)
+    return 0;
+  struct GridTr_query_aabb_s q = {aabb, grid->colliders->data, visited, out,
+                                  max, 0};
+  GridTr_visit_set_begin(visited, grid->colliders->num_elems);
+  GridTr_grid_visit_cells(grid,
+                          GridTr_get_grid_cell_for_p(aabb->min, grid->cell_size),
+                          GridTr_get_grid_cell_for_p(aabb->max, grid->cell_size),
+                          GridTr_query_aabb_cell, &q);
+  return q.count;
+}
+
+struct GridTr_query_obb_s {
+  struct vec3_s o;
+  const struct vec3_s *axes;
+  struct vec3_s half_size;
+  const struct GridTr_collider_s *colliders;
+  struct GridTr_visit_set_s *visited;
+  uint32 *out;
+  uint32 max;
+  uint32 count;
+};
+
+static bool GridTr_query_obb_cell(const struct GridTr_grid_cell_s *cell,
+                                  void *user_data) {
+  struct GridTr_query_obb_s *q = user_data;
+  // the enclosing box range has plenty of cells the obb misses
+  if (!GridTr_aabb_touches_obb(&cell->aabb, q->o, q->axes, q->half_size))
+    return false;
+  for (uint32 i = 0; i < cell->num_colliders; i++) {
+    uint32 idx = cell->colliders[i];
+    if (!GridTr_visit_set_test_and_set(q->visited, idx))
+      continue;
+    if (!GridTr_collider_touches_obb(&q->colliders[idx], q->o, q->axes,
+                                     q->half_size))
+      continue;
+    if (q->count < q->max)
+      q->out[q->count] = idx;
+    q->count++;
+  }
+  return false;
+}
+
+uint32 GridTr_grid_query_obb(const struct GridTr_grid_s *grid, struct vec3_s o,
+                             const struct vec3_s *axes, struct vec3_s half_size,
+                             struct GridTr_visit_set_s *visited, uint32 *out,
+                             uint32 max) {
+  if (!grid || !axes || !visited || (!out && max)) {
+    printf("<%s> - invalid argument(s)\n", __FUNCTION__);
+    return 0;
+  }
+  if (grid->cell_size <= GridTr_CELL_SIZE_AUTO)
+    return 0;
+  struct GridTr_query_obb_s q = {o,       axes, half_size, grid->colliders->data,
+                                 visited, out,  max,       0};
+  // enclosing aabb: per world axis, the box's projected radius
+  struct vec3_s r;
+  for (int i = 0; i < 3; i++) {
+    r.xyz[i] = fabsf(axes[0].xyz[i]) * half_size.x +
+               fabsf(axes[1].xyz[i]) * half_size.y +
+               fabsf(axes[2].xyz[i]) * half_size.z;
+  }
+  GridTr_visit_set_begin(visited, grid->colliders->num_elems);
+  GridTr_grid_visit_cells(
+      grid, GridTr_get_grid_cell_for_p(vec3_sub(o, r), grid->cell_size),
+      GridTr_get_grid_cell_for_p(vec3_add(o, r), grid->cell_size),
+      GridTr_query_obb_cell, &q);
+  return q.count;
+}
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "grid.h"
+
+struct GridTr_hit_s {
+  float t; // distance along the rayseg
+  uint32 collider_idx;
+  struct vec3_s p;
+  struct vec3_s n; // collider normal, flipped to face the ray origin
+};
+
+// per-query mailbox: colliders straddle several cells, so remember the last
+// few tested ids and skip the repeats. direct-mapped, so an eviction only
+// costs a retest, never a missed collider
+#define GridTr_MAILBOX_SIZE 64
+
+struct GridTr_mailbox_s {
+  uint32 ids[GridTr_MAILBOX_SIZE];
+};
+
+static inline void GridTr_mailbox_clear(struct GridTr_mailbox_s *mailbox) {
+  for (uint i = 0; i < GridTr_MAILBOX_SIZE; i++)
+    mailbox->ids[i] = UINT32_MAX;
+}
+
+// returns true if idx is marked as tested, without marking it
+static inline bool GridTr_mailbox_has(const struct GridTr_mailbox_s *mailbox,
+                                      uint32 idx) {
+  return mailbox->ids[idx & (GridTr_MAILBOX_SIZE - 1)] == idx;
+}
+
+// returns true if idx still needs testing (and marks it as tested)
+static inline bool GridTr_mailbox_test_and_set(struct GridTr_mailbox_s *mailbox,
+                                               uint32 idx) {
+  uint32 *slot = &mailbox->ids[idx & (GridTr_MAILBOX_SIZE - 1)];
+  if (*slot == idx)
+    return false;
+  *slot = idx;
+  return true;
+}
+
+// per-query visited set for queries that can touch many colliders: one
+// stamp per collider, a collider is visited once its stamp equals the
+// current generation. begin only allocates when the grid outgrew the set,
+// so queries don't allocate
+struct GridTr_visit_set_s {
+  uint32 *stamps;
+  uint32 max_stamps;
+  uint32 generation;
+};
+
+void GridTr_create_visit_set(struct GridTr_visit_set_s *set);
+
+void GridTr_destroy_visit_set(struct GridTr_visit_set_s *set);
+
+// starts a new query over num_colliders colliders, forgets all visits
+void GridTr_visit_set_begin(struct GridTr_visit_set_s *set,
+                            uint32 num_colliders);
+
+// returns true the first time idx is seen in this query
+static inline bool GridTr_visit_set_test_and_set(struct GridTr_visit_set_s *set,
+                                                 uint32 idx) {
+  if (set->stamps[idx] == set->generation)
+    return false;
+  set->stamps[idx] = set->generation;
+  return true;
+}
+
+// closest polygon along rayseg, returns false on a miss (hit is untouched)
+bool GridTr_raycast_closest(const struct GridTr_grid_s *grid,
+                            const struct GridTr_rayseg_s *rayseg,
+                            struct GridTr_hit_s *hit);
+
+// same, and adds the polygons it tested to *num_tests (a tri packet, see
+// GridTr_grid_build_tri_packets(), counts as one). for tuning and benches
+bool GridTr_raycast_closest_counted(const struct GridTr_grid_s *grid,
+                                    const struct GridTr_rayseg_s *rayseg,
+                                    struct GridTr_hit_s *hit,
+                                    uint32 *num_tests);
+
+// compact result of GridTr_trace_batch(). a miss is t FLT_MAX, collider_idx
+// UINT32_MAX and a zero n
+struct GridTr_batch_hit_s {
+  float t;
+  uint32 collider_idx;
+  struct vec3_s n; // flipped to face the ray origin
+};
+
+// closest hit for n rays passed as arrays: origins (ox, oy, oz), unit length
+// directions (dx, dy, dz) and segment lengths len. one validation for the
+// whole batch and no callbacks, hits_out[i] is ray i's. returns the number
+// of rays that hit
+uint32 GridTr_trace_batch(const struct GridTr_grid_s *grid, const float *ox,
+                          const float *oy, const float *oz, const float *dx,
+                          const float *dy, const float *dz, const float *len,
+                          uint32 n, struct GridTr_batch_hit_s *hits_out);
+
+struct GridTr_thread_pool_s;
+
+// rays per pool task in GridTr_trace_batch_parallel()
+#define GridTr_TRACE_BATCH_CHUNK 64
+
+// GridTr_trace_batch() spread over pool's workers in chunks of rays. the
+// grid is only read, so it can be shared by any number of batches as long
+// as nothing adds, removes or freezes meanwhile
+uint32 GridTr_trace_batch_parallel(struct GridTr_thread_pool_s *pool,
+                                   const struct GridTr_grid_s *grid,
+                                   const float *ox, const float *oy,
+                                   const float *oz, const float *dx,
+                                   const float *dy, const float *dz,
+                                   const float *len, uint32 n,
+                                   struct GridTr_batch_hit_s *hits_out);
+
+// true as soon as any polygon crosses rayseg (line of sight checks)
+bool GridTr_raycast_any(const struct GridTr_grid_s *grid,
+                        const struct GridTr_rayseg_s *rayseg);
+
+// every polygon rayseg crosses, nearest first, each once. fills at most
+// max_hits and returns how many; a full buffer holds the max_hits nearest
+// and the walk stops there
+uint32 GridTr_raycast_all(const struct GridTr_grid_s *grid,
+                          const struct GridTr_rayseg_s *rayseg,
+                          struct GridTr_hit_s *hits, uint32 max_hits);
+
+// sphere swept from sphere->c to `to`: earliest contact along the way. hit->t
+// is the distance the center travelled (0 if it starts touching), hit->n the
+// contact normal (towards the center) and hit->p the contact point
+bool GridTr_spherecast(const struct GridTr_grid_s *grid,
+                       const struct GridTr_sphere_s *sphere, struct vec3_s to,
+                       struct GridTr_hit_s *hit);
+
+// every collider inside the frustum made by planes[GridTr_FRUSTUM_NUM_PLANES]
+// (see GridTr_frustum_s), each once. macro cells, bricks and cells behind a
+// plane are skipped whole, the rest get an exact SAT
+uint32 GridTr_grid_query_frustum(const struct GridTr_grid_s *grid,
+                                 const struct GridTr_plane_s *planes,
+                                 struct GridTr_visit_set_s *visited,
+                                 uint32 *out, uint32 max);
+
+// closest point on any polygon to p, no further than max_dist. hit->t is the
+// distance, hit->p the point and hit->n the unit direction from it to p.
+// searches shells of cells outwards from p's cell and stops at the first
+// shell that can't beat the best so far
+bool GridTr_grid_closest_point(const struct GridTr_grid_s *grid,
+                               struct vec3_s p, float max_dist,
+                               struct GridTr_hit_s *hit);
+
+// every collider touching aabb, each once. the first max go to out, the
+// return value is the total so a full buffer can be told apart
+uint32 GridTr_grid_query_aabb(const struct GridTr_grid_s *grid,
+                              const struct GridTr_aabb_s *aabb,
+                              struct GridTr_visit_set_s *visited, uint32 *out,
+                              uint32 max);
+
+// same for an oriented box: center o, unit axes[3], half extents half_size
+// along them. cells are culled against the box before their colliders get
+// the full box vs polygon SAT
+uint32 GridTr_grid_query_obb(const struct GridTr_grid_s *grid, struct vec3_s o,
+                             const struct vec3_s *axes, struct vec3_s half_size,
+                             struct GridTr_visit_set_s *visited, uint32 *out,
+                             uint32 max);
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "defs.h"
+
+// thin wrapper over the widest float vectors the compiler targets: 8 lanes
+// with AVX2, 4 with SSE2 and a plain 4 lane struct otherwise. masks are
+// GridTr_vf too, all bits set in a lane means true. GridTr_NO_SIMD forces
+// the scalar version
+#if defined(__AVX2__) && !defined(GridTr_NO_SIMD)
+#include <immintrin.h>
+#define GridTr_SIMD_AVX2
+#define GridTr_SIMD_WIDTH 8
+typedef __m256 GridTr_vf;
+#elif (defined(__SSE2__) || defined(_M_X64)) && !defined(GridTr_NO_SIMD)
+#include <emmintrin.h>
+#define GridTr_SIMD_SSE2
+#define GridTr_SIMD_WIDTH 4
+typedef __m128 GridTr_vf;
+#else
+#define GridTr_SIMD_SCALAR
+#define GridTr_SIMD_WIDTH 4
+typedef struct {
+  union {
+    float f[4];
+    uint32 u[4];
+  };
+} GridTr_vf;
+#endif
+
+// alignment for arrays loaded with GridTr_vf_load(), GridTr_vf_loadu() takes
+// any float pointer
+#define GridTr_SIMD_ALIGN (GridTr_SIMD_WIDTH * sizeof(float))
+
+#if defined(GridTr_SIMD_AVX2)
+
+static inline GridTr_vf GridTr_vf_set1(float a) { return _mm256_set1_ps(a); }
+static inline GridTr_vf GridTr_vf_load(const float *p) {
+  return _mm256_load_ps(p);
+}
+static inline GridTr_vf GridTr_vf_loadu(const float *p) {
+  return _mm256_loadu_ps(p);
+}
+static inline void GridTr_vf_store(float *p, GridTr_vf a) {
+  _mm256_store_ps(p, a);
+}
+static inline GridTr_vf GridTr_vf_add(GridTr_vf a, GridTr_vf b) {
+  return _mm256_add_ps(a, b);
+}
+static inline GridTr_vf GridTr_vf_sub(GridTr_vf a, GridTr_vf b) {
+  return _mm256_sub_ps(a, b);
+}
+static inline GridTr_vf GridTr_vf_mul(GridTr_vf a, GridTr_vf b) {
+  return _mm256_mul_ps(a, b);
+}
+static inline GridTr_vf GridTr_vf_div(GridTr_vf a, GridTr_vf b) {
+  return _mm256_div_ps(a, b);
+}
+static inline GridTr_vf GridTr_vf_min(GridTr_vf a, GridTr_vf b) {
+  return _mm256_min_ps(a, b);
+}
+static inline GridTr_vf GridTr_vf_max(GridTr_vf a, GridTr_vf b) {
+  return _mm256_max_ps(a, b);
+}
+static inline GridTr_vf GridTr_vf_and(GridTr_vf a, GridTr_vf b) {
+  return _mm256_and_ps(a, b);
+}
+static inline GridTr_vf GridTr_vf_or(GridTr_vf a, GridTr_vf b) {
+  return _mm256_or_ps(a, b);
+}
+// ~a & b
+static inline GridTr_vf GridTr_vf_andnot(GridTr_vf a, GridTr_vf b) {
+  return _mm256_andnot_ps(a, b);
+}
+static inline GridTr_vf GridTr_vf_lt(GridTr_vf a, GridTr_vf b) {
+  return _mm256_cmp_ps(a, b, _CMP_LT_OQ);
+}
+static inline GridTr_vf GridTr_vf_le(GridTr_vf a, GridTr_vf b) {
+  return _mm256_cmp_ps(a, b, _CMP_LE_OQ);
+}
+// mask ? a : b
+static inline GridTr_vf GridTr_vf_select(GridTr_vf mask, GridTr_vf a,
+                                         GridTr_vf b) {
+  return _mm256_blendv_ps(b, a, mask);
+}
+// one bit per lane, lane 0 in bit 0
+static inline uint32 GridTr_vf_movemask(GridTr_vf mask) {
+  return (uint32)_mm256_movemask_ps(mask);
+}
+
+#elif defined(GridTr_SIMD_SSE2)
+
+static inline GridTr_vf GridTr_vf_set1(float a) { return _mm_set1_ps(a); }
+static inline GridTr_vf GridTr_vf_load(const float *p) { return _mm_load_ps(p); }
+static inline GridTr_vf GridTr_vf_loadu(const float *p) {
+  return _mm_loadu_ps(p);
+}
+static inline void GridTr_vf_store(float *p, GridTr_vf a) { _mm_store_ps(p, a); }
+static inline GridTr_vf GridTr_vf_add(GridTr_vf a, GridTr_vf b) {
+  return _mm_add_ps(a, b);
+}
+static inline GridTr_vf GridTr_vf_sub(GridTr_vf a, GridTr_vf b) {
+  return _mm_sub_ps(a, b);
+}
+static inline GridTr_vf GridTr_vf_mul(GridTr_vf a, GridTr_vf b) {
+  return _mm_mul_ps(a, b);
+}
+static inline GridTr_vf GridTr_vf_div(GridTr_vf a, GridTr_vf b) {
+  return _mm_div_ps(a, b);
+}
+static inline GridTr_vf GridTr_vf_min(GridTr_vf a, GridTr_vf b) {
+  return _mm_min_ps(a, b);
+}
+static inline GridTr_vf GridTr_vf_max(GridTr_vf a, GridTr_vf b) {
+  return _mm_max_ps(a, b);
+}
+static inline GridTr_vf GridTr_vf_and(GridTr_vf a, GridTr_vf b) {
+  return _mm_and_ps(a, b);
+}
+static inline GridTr_vf GridTr_vf_or(GridTr_vf a, GridTr_vf b) {
+  return _mm_or_ps(a, b);
+}
+// ~a & b
+static inline GridTr_vf GridTr_vf_andnot(GridTr_vf a, GridTr_vf b) {
+  return _mm_andnot_ps(a, b);
+}
+static inline GridTr_vf GridTr_vf_lt(GridTr_vf a, GridTr_vf b) {
+  return _mm_cmplt_ps(a, b);
+}
+static inline GridTr_vf GridTr_vf_le(GridTr_vf a, GridTr_vf b) {
+  return _mm_cmple_ps(a, b);
+}
+// mask ? a : b (no blendv before SSE4.1)
+static inline GridTr_vf GridTr_vf_select(GridTr_vf mask, GridTr_vf a,
+                                         GridTr_vf b) {
+  return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+// one bit per lane, lane 0 in bit 0
+static inline uint32 GridTr_vf_movemask(GridTr_vf mask) {
+  return (uint32)_mm_movemask_ps(mask);
+}
+
+#else
+
+#define GridTr_VF_MAP(expr)                                                    \
+  GridTr_vf r;                                                                 \
+  for (int i = 0; i < 4; i++)                                                  \
+    expr;                                                                      \
+  return r
+
+static inline GridTr_vf GridTr_vf_set1(float a) {
+  GridTr_VF_MAP(r.f[i] = a);
+}
+static inline GridTr_vf GridTr_vf_load(const float *p) {
+  GridTr_VF_MAP(r.f[i] = p[i]);
+}
+static inline GridTr_vf GridTr_vf_loadu(const float *p) {
+  GridTr_VF_MAP(r.f[i] = p[i]);
+}
+static inline void GridTr_vf_store(float *p, GridTr_vf a) {
+  for (int i = 0; i < 4; i++)
+    p[i] = a.f[i];
+}
+static inline GridTr_vf GridTr_vf_add(GridTr_vf a, GridTr_vf b) {
+  GridTr_VF_MAP(r.f[i] = a.f[i] + b.f[i]);
+}
+static inline GridTr_vf GridTr_vf_sub(GridTr_vf a, GridTr_vf b) {
+  GridTr_VF_MAP(r.f[i] = a.f[i] - b.f[i]);
+}
+static inline GridTr_vf GridTr_vf_mul(GridTr_vf a, GridTr_vf b) {
+  GridTr_VF_MAP(r.f[i] = a.f[i] * b.f[i]);
+}
+static inline GridTr_vf GridTr_vf_div(GridTr_vf a, GridTr_vf b) {
+  GridTr_VF_MAP(r.f[i] = a.f[i] / b.f[i]);
+}
+static inline GridTr_vf GridTr_vf_min(GridTr_vf a, GridTr_vf b) {
+  GridTr_VF_MAP(r.f[i] = a.f[i] < b.f[i] ? a.f[i] : b.f[i]);
+}
+static inline GridTr_vf GridTr_vf_max(GridTr_vf a, GridTr_vf b) {
+  GridTr_VF_MAP(r.f[i] = a.f[i] > b.f[i] ? a.f[i] : b.f[i]);
+}
+static inline GridTr_vf GridTr_vf_and(GridTr_vf a, GridTr_vf b) {
+  GridTr_VF_MAP(r.u[i] = a.u[i] & b.u[i]);
+}
+static inline GridTr_vf GridTr_vf_or(GridTr_vf a, GridTr_vf b) {
+  GridTr_VF_MAP(r.u[i] = a.u[i] | b.u[i]);
+}
+// ~a & b
+static inline GridTr_vf GridTr_vf_andnot(GridTr_vf a, GridTr_vf b) {
+  GridTr_VF_MAP(r.u[i] = ~a.u[i] & b.u[i]);
+}
+static inline GridTr_vf GridTr_vf_lt(GridTr_vf a, GridTr_vf b) {
+  GridTr_VF_MAP(r.u[i] = a.f[i] < b.f[i] ? UINT32_MAX : 0);
+}
+static inline GridTr_vf GridTr_vf_le(GridTr_vf a, GridTr_vf b) {
+  GridTr_VF_MAP(r.u[i] = a.f[i] <= b.f[i] ? UINT32_MAX : 0);
+}
+// mask ? a : b
+static inline GridTr_vf GridTr_vf_select(GridTr_vf mask, GridTr_vf a,
+                                         GridTr_vf b) {
+  GridTr_VF_MAP(r.u[i] = (mask.u[i] & a.u[i]) | (~mask.u[i] & b.u[i]));
+}
+// one bit per lane, lane 0 in bit 0
+static inline uint32 GridTr_vf_movemask(GridTr_vf mask) {
+  uint32 bits = 0;
+  for (int i = 0; i < 4; i++)
+    bits |= (mask.u[i] >> 31) << i;
+  return bits;
+}
+
+#undef GridTr_VF_MAP
+
+#endif
+
+static inline GridTr_vf GridTr_vf_abs(GridTr_vf a) {
+  return GridTr_vf_max(a, GridTr_vf_sub(GridTr_vf_set1(0.0f), a));
+}
+
+// a.x * b.x + a.y * b.y + a.z * b.z, lane by lane
+static inline GridTr_vf GridTr_vf_dot3(GridTr_vf ax, GridTr_vf ay, GridTr_vf az,
+                                       GridTr_vf bx, GridTr_vf by,
+                                       GridTr_vf bz) {
+  return GridTr_vf_add(
+      GridTr_vf_add(GridTr_vf_mul(ax, bx), GridTr_vf_mul(ay, by)),
+      GridTr_vf_mul(az, bz));
+}
@@ -275,6 +275,25 @@ static void test_array_dtors() {
   ASSERT_EQ_I(g_array_data_dtor_count, N);
 }
 
+static void test_array_reserve() {
+  struct GridTr_array_s *a = GridTr_create_array(sizeof(int), 4, 4);
+  for (int i = 0; i < 3; i++)
+    GridTr_array_add(a, &i);
+  GridTr_array_reserve(a, 100);
+  ASSERT_EQ_U(a->max_elems, 100);
+  ASSERT_EQ_U(a->num_elems, 3);
+  void *data = a->data;
+  for (int i = 3; i < 100; i++)
+    GridTr_array_add(a, &i);
+  ASSERT_TRUE(a->data == data);
+  for (int i = 0; i < 100; i++)
+    ASSERT_EQ_I(*(int *)GridTr_array_get(a, i), i);
+  // never shrinks
+  GridTr_array_reserve(a, 10);
+  ASSERT_EQ_U(a->max_elems, 100);
+  GridTr_destroy_array(&a);
+}
+
 static void run_array_tests(void) {
   printf("[array] begin test:\n");
   test_array_create_destroy();
@@ -289,5 +308,6 @@ static void run_array_tests(void) {
   test_array_swap_free_last();
   test_array_swap_free_oob_noop();
   test_array_dtors();
+  test_array_reserve();
   printf("[array] tests run: %d, failed: %d\n", g_tests_run, g_tests_failed);
 }
@@ -247,6 +247,144 @@ static void aabb_touches_colliders_test() {
   GridTr_destroy_collider(&poly);
 }
 
+static void test_collider_sat_matches_touches_aabb(void) {
+  uint32 rng = 7, tested = 0, same = 0, touched = 0;
+  for (int k = 0; k < 400; k++) {
+    // triangles and parallelograms, every 4th one snapped to a grid plane so
+    // faces and edges land right on box faces
+    uint32 nps = 3 + (k & 1);
+    struct vec3_s o = vec3_set(test_randf(&rng, -2.0f, 2.0f),
+                               test_randf(&rng, -2.0f, 2.0f),
+                               test_randf(&rng, -2.0f, 2.0f));
+    struct vec3_s u = vec3_set(test_randf(&rng, -1.5f, 1.5f),
+                               test_randf(&rng, -1.5f, 1.5f),
+                               test_randf(&rng, -1.5f, 1.5f));
+    struct vec3_s v = vec3_set(test_randf(&rng, -1.5f, 1.5f),
+                               test_randf(&rng, -1.5f, 1.5f),
+                               test_randf(&rng, -1.5f, 1.5f));
+    if (k % 4 == 2) {
+      o.z = 0.5f;
+      u.z = v.z = 0.0f;
+    }
+    struct vec3_s ps[4] = {o, vec3_add(o, u), vec3_add(vec3_add(o, u), v),
+                           vec3_add(o, v)};
+    if (nps == 3)
+      ps[2] = vec3_add(o, v);
+    struct vec3_s n = vec3_cross(u, v);
+    if (vec3_lensq(n) < 1e-4f)
+      continue;
+    struct GridTr_collider_s poly;
+    GridTr_create_collider(&poly, k, ps, nps,
+                           GridTr_create_plane(vec3_norm(n), ps[0]));
+    struct GridTr_collider_sat_s sat;
+    ASSERT_TRUE(GridTr_collider_sat_init(&sat, &poly));
+    for (int z = -3; z < 3; z++) {
+      for (int y = -3; y < 3; y++) {
+        for (int x = -3; x < 3; x++) {
+          struct GridTr_aabb_s aabb;
+          float cs = 0.5f;
+          GridTr_aabb_init(&aabb, vec3_set(x * cs, y * cs, z * cs),
+                           vec3_set((x + 1) * cs, (y + 1) * cs, (z + 1) * cs));
+          bool ref = GridTr_collider_touches_aabb(&poly, &aabb);
+          same += GridTr_collider_sat_touches_aabb(&sat, &aabb) == ref;
+          touched += ref;
+          tested++;
+        }
+      }
+    }
+    GridTr_destroy_collider(&poly);
+  }
+  ASSERT_TRUE(touched > 0 && touched < tested);
+  ASSERT_EQ_U(same, tested);
+
+  // anything else goes through GridTr_collider_touches_aabb()
+  struct vec3_s pent[5] = {{{{0.0f, 0.0f, 0.0f}}}, {{{1.0f, 0.0f, 0.0f}}},
+                           {{{1.5f, 1.0f, 0.0f}}}, {{{0.5f, 1.5f, 0.0f}}},
+                           {{{-0.5f, 1.0f, 0.0f}}}};
+  struct GridTr_collider_s poly;
+  GridTr_create_collider(
+      &poly, 0, pent, 5,
+      GridTr_create_plane(vec3_set(0.0f, 0.0f, 1.0f), pent[0]));
+  struct GridTr_collider_sat_s sat;
+  ASSERT_FALSE(GridTr_collider_sat_init(&sat, &poly));
+  GridTr_destroy_collider(&poly);
+}
+
+static bool collide_same_collider(const struct GridTr_collider_s *a,
+                                  const struct GridTr_collider_s *b) {
+  bool same = a->poly_id == b->poly_id && a->edge_count == b->edge_count &&
+              memcmp(&a->plane, &b->plane, sizeof(a->plane)) == 0 &&
+              memcmp(&a->o, &b->o, sizeof(a->o)) == 0;
+  for (uint32 i = 0; same && i < a->edge_count; i++) {
+    same = memcmp(&a->ps[i], &b->ps[i], sizeof(a->ps[i])) == 0 &&
+           memcmp(&a->es[i], &b->es[i], sizeof(a->es[i])) == 0 &&
+           memcmp(&a->edge_planes[i], &b->edge_planes[i],
+                  sizeof(a->edge_planes[i])) == 0 &&
+           a->edge_lens[i] == b->edge_lens[i];
+  }
+  return same;
+}
+
+extern uint32 g_num_allocs;
+
+static void test_collider_pool(void) {
+  struct vec3_s ps[4] = {{{{0.0f, 0.0f, 0.0f}}}, {{{1.0f, 0.0f, 0.0f}}},
+                         {{{1.0f, 1.0f, 0.0f}}}, {{{0.0f, 1.0f, 0.0f}}}};
+  struct GridTr_plane_s plane =
+      GridTr_create_plane(vec3_set(0.0f, 0.0f, 1.0f), ps[0]);
+  struct GridTr_collider_s ref[2], pooled[3];
+  GridTr_create_collider(&ref[0], 1, ps, 4, plane);
+  GridTr_create_collider(&ref[1], 2, ps, 3, plane);
+
+  struct GridTr_collider_pool_s pool;
+  GridTr_create_collider_pool(&pool, 8);
+  ASSERT_TRUE(GridTr_create_collider_pooled(&pool, &pooled[0], 1, ps, 4, plane));
+  ASSERT_TRUE(GridTr_copy_collider_pooled(&pool, &pooled[1], &ref[1]));
+  ASSERT_EQ_U(pool.num_edges, 7);
+  ASSERT_FALSE(GridTr_copy_collider_pooled(&pool, &pooled[2], &ref[0]));
+  ASSERT_TRUE(pooled[1].ps == pool.ps + 4 && pooled[1].pool_offset == 4);
+  ASSERT_TRUE(collide_same_collider(&pooled[0], &ref[0]));
+  ASSERT_TRUE(collide_same_collider(&pooled[1], &ref[1]));
+
+  // the first one goes away, growing packs the second to the front
+  GridTr_destroy_collider(&pooled[0]);
+  memset(&pooled[0], 0, sizeof(pooled[0]));
+  GridTr_collider_pool_reserve(&pool, pooled, 2, 4);
+  ASSERT_EQ_U(pool.num_edges, 3);
+  ASSERT_TRUE(pool.max_edges >= 7);
+  ASSERT_TRUE(pooled[1].ps == pool.ps && pooled[1].pool_offset == 0);
+  ASSERT_TRUE(collide_same_collider(&pooled[1], &ref[1]));
+  ASSERT_TRUE(GridTr_copy_collider_pooled(&pool, &pooled[2], &ref[0]));
+  ASSERT_TRUE(collide_same_collider(&pooled[2], &ref[0]));
+  GridTr_destroy_collider(&pooled[1]);
+  GridTr_destroy_collider(&pooled[2]);
+  GridTr_destroy_collider_pool(&pool);
+  GridTr_destroy_collider(&ref[0]);
+  GridTr_destroy_collider(&ref[1]);
+
+  // a pooled load is the collider array plus the pool's four arrays
+  struct GridTr_collider_s *colls, *pooled_colls;
+  uint32 n, pooled_n;
+  ASSERT_TRUE(
+      GridTr_load_colliders_from_obj(&colls, &n, "colliders.obj"));
+  uint32 num_allocs = g_num_allocs;
+  ASSERT_TRUE(GridTr_load_colliders_from_obj_pooled(
+      &pooled_colls, &pooled_n, &pool, "colliders.obj"));
+  ASSERT_EQ_U(g_num_allocs - num_allocs, 5);
+  ASSERT_EQ_U(pooled_n, n);
+  bool same = true;
+  for (uint32 i = 0; i < n; i++)
+    same = same && collide_same_collider(&pooled_colls[i], &colls[i]);
+  ASSERT_TRUE(same);
+  for (uint32 i = 0; i < n; i++) {
+    GridTr_destroy_collider(&colls[i]);
+    GridTr_destroy_collider(&pooled_colls[i]);
+  }
+  GridTr_free(colls);
+  GridTr_free(pooled_colls);
+  GridTr_destroy_collider_pool(&pool);
+}
+
 static void run_collide_tests(void) {
   printf("[collide] begin test:\n");
   test_sat_olap_basics();
@@ -254,5 +392,7 @@ static void run_collide_tests(void) {
   test_sat_setr();
   test_sat_setas();
   aabb_touches_colliders_test();
+  test_collider_sat_matches_touches_aabb();
+  test_collider_pool();
   printf("[collide] tests run: %d, failed: %d\n", g_tests_run, g_tests_failed);
 }
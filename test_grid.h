@@ -1,4 +1,6 @@
 #include "export.h" //include grid.h
+#include "pool.h"
+#include "query.h"
 #include "testing.h"
 #include <stdint.h>
 #include <stdlib.h>
@@ -267,6 +269,713 @@ void grid_test_march_through_grid() {
   GridTr_destroy_grid(&g);
 }
 
+void grid_test_walk_cells() {
+  struct GridTr_grid_s g;
+  memset(&g, 0, sizeof(struct GridTr_grid_s));
+  GridTr_create_grid(&g, 2.0f);
+
+  // crosses x boundaries at t = 1, 3 and y = 2 at t = 2 (not a tie)
+  struct GridTr_rayseg_s rayseg = GridTr_create_rayseg(
+      vec3_set(1.0f, 1.0f, 1.0f), vec3_set(5.0f, 3.0f, 1.0f));
+  struct GridTr_grid_walk_s walk;
+  GridTr_grid_walk_init(&walk, &g, &rayseg);
+  struct ivec3_s crls[4] = {
+      {{{0, 0, 0}}}, {{{1, 0, 0}}}, {{{1, 1, 0}}}, {{{2, 1, 0}}}};
+  float exits[4] = {1.0f, 2.0f, 3.0f, rayseg.len};
+  int n = 0;
+  do {
+    ASSERT_TRUE(n < 4);
+    ASSERT_IV3EQ(walk.crl, crls[n]);
+    ASSERT_FEQ(walk.t_exit, exits[n] * (n < 3 ? rayseg.len / 4.0f : 1.0f));
+    n++;
+  } while (GridTr_grid_walk_step(&walk));
+  ASSERT_EQ_I(n, 4);
+  ASSERT_TRUE(walk.last);
+
+  GridTr_destroy_grid(&g);
+}
+
+struct grid_user_data_2 {
+  uint32 num_cells;
+  struct ivec3_s crls[256];
+};
+
+bool grid_collect_occupied_cb(const struct GridTr_grid_cell_s *cell,
+                              struct ivec3_s crl,
+                              const struct GridTr_rayseg_s *rayseg,
+                              const struct GridTr_collider_s *colliders,
+                              void *user_data) {
+  (void)rayseg;
+  (void)colliders;
+  struct grid_user_data_2 *data = (struct grid_user_data_2 *)user_data;
+  if (cell && data->num_cells < 256)
+    data->crls[data->num_cells++] = crl;
+  return false;
+}
+
+void grid_test_skip_empty_cells() {
+  struct GridTr_collider_s *colls = NULL;
+  uint32 n = 0;
+  GridTr_load_colliders_from_obj(&colls, &n, "colliders.obj");
+  struct GridTr_grid_s g;
+  GridTr_create_grid(&g, 1.0f);
+  for (uint32 i = 0; i < n; i++) {
+    GridTr_add_collider_to_grid(&g, &colls[i]);
+    GridTr_destroy_collider(&colls[i]);
+  }
+  GridTr_free(colls);
+
+  ASSERT_TRUE(GridTr_grid_cell_occupied(&g, ivec3_set(-2, 0, 0)));
+  ASSERT_TRUE(GridTr_grid_cell_occupied(&g, ivec3_set(3, 2, 3)));
+  ASSERT_FALSE(GridTr_grid_cell_occupied(&g, ivec3_set(0, 0, 0)));
+  ASSERT_FALSE(GridTr_grid_cell_occupied(&g, ivec3_set(-40, 7, 100)));
+
+  // long rays from far outside so whole macro cells get skipped
+  uint32 rng = 99, total = 0;
+  struct grid_user_data_2 *all = GridTr_new(sizeof(struct grid_user_data_2));
+  struct grid_user_data_2 *skip = GridTr_new(sizeof(struct grid_user_data_2));
+  for (int i = 0; i < 500; i++) {
+    struct vec3_s p[2];
+    for (int j = 0; j < 2; j++) {
+      for (int k = 0; k < 3; k++)
+        p[j].xyz[k] = test_randf(&rng, -40.0f, 40.0f);
+    }
+    // aim through the occupied region half of the time
+    if (i & 1)
+      p[1] = vec3_add(vec3_set(0.5f, 1.0f, 1.5f),
+                      vec3_mul(point_vec(p[0], vec3_set(0.5f, 1.0f, 1.5f)),
+                               1.0f));
+    struct GridTr_rayseg_s rayseg = GridTr_create_rayseg(p[0], p[1]);
+    all->num_cells = skip->num_cells = 0;
+    GridTr_trace_ray_through_grid(&g, &rayseg, grid_collect_occupied_cb, all);
+    GridTr_trace_ray_through_grid_ex(&g, &rayseg, GridTr_TRACE_SKIP_EMPTY,
+                                     grid_collect_occupied_cb, skip);
+    ASSERT_EQ_U(skip->num_cells, all->num_cells);
+    total += all->num_cells;
+    for (uint32 j = 0; j < all->num_cells; j++)
+      ASSERT_IV3EQ(skip->crls[j], all->crls[j]);
+  }
+  ASSERT_TRUE(total > 0);
+  GridTr_free(all);
+  GridTr_free(skip);
+  GridTr_destroy_grid(&g);
+}
+
+void grid_test_dense_matches_sparse() {
+  struct GridTr_collider_s *colls = NULL;
+  uint32 n = 0;
+  GridTr_load_colliders_from_obj(&colls, &n, "colliders.obj");
+
+  // bounds only cover part of the colliders, the rest falls back to hashing
+  struct GridTr_aabb_s bounds;
+  GridTr_aabb_init(&bounds, vec3_set(0.0f, 0.0f, 0.0f),
+                   vec3_set(3.5f, 3.5f, 3.5f));
+  struct GridTr_grid_s sparse, dense;
+  GridTr_create_grid(&sparse, 1.0f);
+  GridTr_create_grid_dense(&dense, 1.0f, &bounds);
+  ASSERT_TRUE(dense.dense_cells != NULL);
+  ASSERT_EQ_I(dense.dense_dims.x, 4);
+  for (uint32 i = 0; i < n; i++) {
+    GridTr_add_collider_to_grid(&sparse, &colls[i]);
+    GridTr_add_collider_to_grid(&dense, &colls[i]);
+    GridTr_destroy_collider(&colls[i]);
+  }
+  GridTr_free(colls);
+
+  uint32 num_sparse, num_dense;
+  const void **cells = GridTr_grid_get_all_grid_cells(&sparse, &num_sparse);
+  void *p = (void *)GridTr_grid_get_all_grid_cells(&dense, &num_dense);
+  GridTr_free(p);
+  ASSERT_EQ_U(num_dense, num_sparse);
+  for (uint32 i = 0; i < num_sparse; i++) {
+    const struct GridTr_grid_cell_s *a = cells[i];
+    const struct GridTr_grid_cell_s *b =
+        GridTr_grid_get_grid_cell_ro(&dense, a->crl);
+    ASSERT_TRUE(b != NULL);
+    ASSERT_EQ_U(b->num_colliders, a->num_colliders);
+    for (uint32 j = 0; j < a->num_colliders; j++)
+      ASSERT_EQ_U(b->colliders[j], a->colliders[j]);
+  }
+  ASSERT_TRUE(GridTr_grid_get_grid_cell_ro(&dense, ivec3_set(0, 0, 0)) ==
+              NULL);
+  ASSERT_TRUE(GridTr_grid_get_grid_cell_ro(&dense, ivec3_set(-2, 0, 0)) !=
+              NULL);
+  p = (void *)cells;
+  GridTr_free(p);
+
+  // both traces hand the same cells to the callback
+  struct grid_user_data_2 *a = GridTr_new(sizeof(struct grid_user_data_2));
+  struct grid_user_data_2 *b = GridTr_new(sizeof(struct grid_user_data_2));
+  a->num_cells = b->num_cells = 0;
+  struct GridTr_rayseg_s rayseg = GridTr_create_rayseg(
+      vec3_set(-3.0f, 0.4f, 0.4f), vec3_set(4.0f, 2.2f, 3.6f));
+  GridTr_trace_ray_through_grid(&sparse, &rayseg, grid_collect_occupied_cb, a);
+  GridTr_trace_ray_through_grid(&dense, &rayseg, grid_collect_occupied_cb, b);
+  ASSERT_EQ_U(a->num_cells, b->num_cells);
+  ASSERT_TRUE(a->num_cells > 0);
+  GridTr_free(a);
+  GridTr_free(b);
+
+  GridTr_destroy_grid(&sparse);
+  GridTr_destroy_grid(&dense);
+  ASSERT_TRUE(dense.dense_cells == NULL);
+}
+
+void grid_test_freeze() {
+  struct GridTr_collider_s *colls = NULL;
+  uint32 n = 0;
+  GridTr_load_colliders_from_obj(&colls, &n, "colliders.obj");
+  struct GridTr_grid_s ref, g;
+  GridTr_create_grid(&ref, 1.0f);
+  GridTr_create_grid(&g, 1.0f);
+  for (uint32 i = 0; i < n; i++) {
+    GridTr_add_collider_to_grid(&ref, &colls[i]);
+    GridTr_add_collider_to_grid(&g, &colls[i]);
+  }
+
+  ASSERT_TRUE(GridTr_grid_freeze(&g));
+  ASSERT_TRUE(g.cell_table == NULL);
+  ASSERT_TRUE(g.frozen != NULL);
+  ASSERT_FALSE(GridTr_grid_freeze(&g));
+  ASSERT_EQ_U(g.frozen->num_cells, 5);
+  ASSERT_EQ_U(g.frozen->num_indices, 30);
+  for (uint32 i = 1; i < g.frozen->num_cells; i++)
+    ASSERT_TRUE(g.frozen->keys[i - 1] < g.frozen->keys[i]);
+
+  uint32 num_cells;
+  const void **cells = GridTr_grid_get_all_grid_cells(&ref, &num_cells);
+  ASSERT_EQ_U(num_cells, g.frozen->num_cells);
+  for (uint32 i = 0; i < num_cells; i++) {
+    const struct GridTr_grid_cell_s *a = cells[i];
+    const struct GridTr_grid_cell_s *b = GridTr_grid_get_grid_cell_ro(&g, a->crl);
+    ASSERT_TRUE(b != NULL);
+    ASSERT_IV3EQ(b->crl, a->crl);
+    ASSERT_EQ_U(b->num_colliders, a->num_colliders);
+    for (uint32 j = 0; j < a->num_colliders; j++)
+      ASSERT_EQ_U(b->colliders[j], a->colliders[j]);
+  }
+  ASSERT_TRUE(GridTr_grid_get_grid_cell_ro(&g, ivec3_set(0, 0, 0)) == NULL);
+  void *p = (void *)cells;
+  GridTr_free(p);
+
+  // tracing sees the same cells, and the frozen grid takes no more colliders
+  struct grid_user_data_2 *a = GridTr_new(sizeof(struct grid_user_data_2));
+  struct grid_user_data_2 *b = GridTr_new(sizeof(struct grid_user_data_2));
+  a->num_cells = b->num_cells = 0;
+  struct GridTr_rayseg_s rayseg = GridTr_create_rayseg(
+      vec3_set(-3.0f, 0.4f, 0.4f), vec3_set(4.0f, 2.2f, 3.6f));
+  GridTr_trace_ray_through_grid(&ref, &rayseg, grid_collect_occupied_cb, a);
+  GridTr_trace_ray_through_grid(&g, &rayseg, grid_collect_occupied_cb, b);
+  ASSERT_EQ_U(a->num_cells, b->num_cells);
+  GridTr_free(a);
+  GridTr_free(b);
+
+  GridTr_add_collider_to_grid(&g, &colls[0]);
+  ASSERT_EQ_U(g.colliders->num_elems, n);
+  GridTr_export_grid_boxes_to_obj(&g, "export/boxes_for_many_colliders.obj");
+
+  for (uint32 i = 0; i < n; i++)
+    GridTr_destroy_collider(&colls[i]);
+  GridTr_free(colls);
+  GridTr_destroy_grid(&ref);
+  GridTr_destroy_grid(&g);
+  ASSERT_TRUE(g.frozen == NULL);
+}
+
+void grid_test_morton_keys() {
+  uint64 m0 = ivec3_morton(ivec3_set(0, 0, 0));
+  ASSERT_TRUE(ivec3_morton(ivec3_set(1, 0, 0)) == m0 + 1);
+  ASSERT_TRUE(ivec3_morton(ivec3_set(0, 1, 0)) == m0 + 2);
+  ASSERT_TRUE(ivec3_morton(ivec3_set(0, 0, 1)) == m0 + 4);
+  ASSERT_TRUE(ivec3_morton(ivec3_set(-1, 0, 0)) <
+              ivec3_morton(ivec3_set(0, 0, 0)));
+
+  struct GridTr_collider_s *colls = NULL;
+  uint32 n = 0;
+  GridTr_load_colliders_from_obj(&colls, &n, "colliders.obj");
+  struct GridTr_grid_s ref, g;
+  GridTr_create_grid(&ref, 1.0f);
+  GridTr_create_grid(&g, 1.0f);
+  ASSERT_TRUE(GridTr_grid_set_cell_key(&g, GridTr_CELL_KEY_MORTON));
+  for (uint32 i = 0; i < n; i++) {
+    GridTr_add_collider_to_grid(&ref, &colls[i]);
+    GridTr_add_collider_to_grid(&g, &colls[i]);
+    GridTr_destroy_collider(&colls[i]);
+  }
+  GridTr_free(colls);
+  ASSERT_FALSE(GridTr_grid_set_cell_key(&g, GridTr_CELL_KEY_FNV1A));
+  GridTr_grid_freeze(&g);
+
+  // every lookup, wherever the hint starts, agrees with the fnv keyed grid
+  uint32 hint = 0;
+  for (int z = -3; z <= 4; z++) {
+    for (int y = -2; y <= 3; y++) {
+      for (int x = -3; x <= 4; x++) {
+        struct ivec3_s crl = ivec3_set(x, y, z);
+        const struct GridTr_grid_cell_s *a =
+            GridTr_grid_get_grid_cell_ro(&ref, crl);
+        const struct GridTr_grid_cell_s *b =
+            GridTr_grid_get_grid_cell_ro_hint(&g, crl, &hint);
+        ASSERT_TRUE((a == NULL) == (b == NULL));
+        if (a && b) {
+          ASSERT_IV3EQ(b->crl, crl);
+          ASSERT_EQ_U(b->num_colliders, a->num_colliders);
+        }
+        uint32 far_hint = (uint32)(x * 7 + y * 3 + z) % 5;
+        b = GridTr_grid_get_grid_cell_ro_hint(&g, crl, &far_hint);
+        ASSERT_TRUE((a == NULL) == (b == NULL));
+      }
+    }
+  }
+  GridTr_destroy_grid(&ref);
+  GridTr_destroy_grid(&g);
+
+  // cells past the 21 bits a morton code holds per axis don't alias the
+  // ones inside
+  struct GridTr_grid_s far;
+  GridTr_create_grid(&far, 1.0f);
+  GridTr_grid_set_cell_key(&far, GridTr_CELL_KEY_MORTON);
+  struct ivec3_s near_crl = ivec3_set(0, 0, 0);
+  struct ivec3_s far_crl = ivec3_set(1 << 21, 0, 0);
+  ASSERT_TRUE(GridTr_grid_cell_key(&far, ivec3_set(-(1 << 20), 0, 0)) ==
+              ivec3_morton(ivec3_set(-(1 << 20), 0, 0)));
+  ASSERT_TRUE(GridTr_grid_cell_key(&far, far_crl) !=
+              GridTr_grid_cell_key(&far, near_crl));
+  for (uint32 i = 0; i < 2; i++) {
+    float x = i ? (float)(1 << 21) : 0.0f;
+    struct vec3_s ps[3] = {vec3_set(x + 0.25f, 0.25f, 0.5f),
+                           vec3_set(x + 0.75f, 0.25f, 0.5f),
+                           vec3_set(x + 0.25f, 0.75f, 0.5f)};
+    struct GridTr_collider_s coll;
+    GridTr_create_collider(&coll, i, ps, 3,
+                           GridTr_create_plane(vec3_set(0.0f, 0.0f, 1.0f),
+                                               ps[0]));
+    GridTr_add_collider_to_grid(&far, &coll);
+    GridTr_destroy_collider(&coll);
+  }
+  const struct GridTr_grid_cell_s *near_cell =
+      GridTr_grid_get_grid_cell_ro(&far, near_crl);
+  const struct GridTr_grid_cell_s *far_cell =
+      GridTr_grid_get_grid_cell_ro(&far, far_crl);
+  ASSERT_TRUE(near_cell && near_cell->num_colliders == 1 &&
+              near_cell->colliders[0] == 0);
+  ASSERT_TRUE(far_cell && far_cell->num_colliders == 1 &&
+              far_cell->colliders[0] == 1);
+  GridTr_destroy_grid(&far);
+}
+
+// n small triangles scattered over a 16 x 16 x 20 box
+static struct GridTr_collider_s *grid_make_random_tris(uint32 n) {
+  struct GridTr_collider_s *colls =
+      GridTr_new(n * sizeof(struct GridTr_collider_s));
+  uint32 seed = 7;
+  for (uint32 i = 0; i < n; i++) {
+    float r[4];
+    for (int a = 0; a < 4; a++)
+      r[a] = test_randf(&seed, 0.0f, 1.0f);
+    struct vec3_s o = vec3_set((float)(i % 16) - 8.0f,
+                               (float)((i / 16) % 16) - 8.0f,
+                               r[0] * 20.0f - 10.0f);
+    struct vec3_s ps[3];
+    ps[0] = o;
+    ps[1] = vec3_set(o.x + 1.0f + r[1] * 2.0f, o.y, o.z + r[3]);
+    ps[2] = vec3_set(o.x, o.y + 1.0f + r[2] * 2.0f, o.z - r[3]);
+    struct vec3_s nrm =
+        vec3_cross(point_vec(ps[0], ps[1]), point_vec(ps[0], ps[2]));
+    GridTr_create_collider(&colls[i], i, ps, 3, GridTr_create_plane(nrm, ps[0]));
+  }
+  return colls;
+}
+
+// the triangles above plus num_polys big slanted polygons: quads, hexagons
+// and, last, a 20-gon (past the voxelizer's edge limit)
+static struct GridTr_collider_s *grid_make_random_polys(uint32 num_tris,
+                                                        uint32 num_polys) {
+  const uint32 n = num_tris + num_polys;
+  struct GridTr_collider_s *tris = grid_make_random_tris(num_tris);
+  struct GridTr_collider_s *colls = GridTr_new(n * sizeof(*colls));
+  memcpy(colls, tris, num_tris * sizeof(*colls));
+  GridTr_free(tris);
+  uint32 seed = 11;
+  for (uint32 i = num_tris; i < n; i++) {
+    float r[6];
+    for (int a = 0; a < 6; a++)
+      r[a] = test_randf(&seed, -1.0f, 1.0f);
+    struct vec3_s o = vec3_set(r[0] * 6.0f, r[1] * 6.0f, r[2] * 6.0f);
+    struct vec3_s u = vec3_norm(vec3_set(r[3], r[4], r[5] + 0.1f));
+    struct vec3_s v = vec3_norm(vec3_cross(u, vec3_set(r[5], 1.0f, r[4])));
+    u = vec3_mul(u, 3.0f + 2.0f * r[0]);
+    v = vec3_mul(v, 3.0f + 2.0f * r[1]);
+    uint32 nps = i == n - 1 ? 20 : i & 1 ? 6 : 4;
+    struct vec3_s ps[20];
+    for (uint32 k = 0; k < nps; k++) {
+      float a = 6.2831853f * (float)k / (float)nps;
+      ps[k] = vec3_add(o, vec3_add(vec3_mul(u, cosf(a)), vec3_mul(v, sinf(a))));
+    }
+    GridTr_create_collider(&colls[i], i, ps, nps,
+                           GridTr_create_plane(vec3_cross(u, v), ps[0]));
+  }
+  return colls;
+}
+
+static void grid_free_colliders(struct GridTr_collider_s *colls, uint32 n) {
+  for (uint32 i = 0; i < n; i++)
+    GridTr_destroy_collider(&colls[i]);
+  GridTr_free(colls);
+}
+
+// same cells, same collider lists in the same order
+static bool grid_same_cells(const struct GridTr_grid_s *ref,
+                            const struct GridTr_grid_s *g) {
+  uint32 num_ref, num_cells;
+  const void **cells = GridTr_grid_get_all_grid_cells(ref, &num_ref);
+  const void **g_cells = GridTr_grid_get_all_grid_cells(g, &num_cells);
+  GridTr_free(g_cells);
+  bool same = num_cells == num_ref;
+  for (uint32 i = 0; i < num_ref; i++) {
+    const struct GridTr_grid_cell_s *a = cells[i];
+    const struct GridTr_grid_cell_s *b = GridTr_grid_get_grid_cell_ro(g, a->crl);
+    same = same && b && b->num_colliders == a->num_colliders &&
+           memcmp(a->colliders, b->colliders,
+                  a->num_colliders * sizeof(uint32)) == 0;
+  }
+  GridTr_free(cells);
+  return same;
+}
+
+void grid_test_build_parallel() {
+  // enough triangles for several build tasks
+  const uint32 n = 1500;
+  struct GridTr_collider_s *colls = grid_make_random_tris(n);
+  struct GridTr_grid_s ref, g;
+  GridTr_create_grid(&ref, 1.0f);
+  GridTr_create_grid(&g, 1.0f);
+  for (uint32 i = 0; i < n; i++)
+    GridTr_add_collider_to_grid(&ref, &colls[i]);
+  struct GridTr_thread_pool_s *pool = GridTr_create_thread_pool(4);
+  GridTr_build_grid_parallel(pool, &g, colls, n);
+  GridTr_destroy_thread_pool(&pool);
+  ASSERT_EQ_U(g.colliders->num_elems, n);
+  ASSERT_TRUE(grid_same_cells(&ref, &g));
+
+  grid_free_colliders(colls, n);
+  GridTr_destroy_grid(&ref);
+  GridTr_destroy_grid(&g);
+}
+
+void grid_test_bulk_build() {
+  const uint32 n = 600, head = 100;
+  struct GridTr_collider_s *colls = grid_make_random_tris(n);
+  struct GridTr_grid_s ref, g;
+  GridTr_create_grid(&ref, 1.0f);
+  GridTr_create_grid(&g, 1.0f);
+  ASSERT_TRUE(GridTr_grid_set_cell_key(&g, GridTr_CELL_KEY_MORTON));
+  for (uint32 i = 0; i < n; i++)
+    GridTr_add_collider_to_grid(&ref, &colls[i]);
+
+  // a bulk build into a fresh grid sizes every list exactly
+  GridTr_build_grid(&g, colls + head, n - head);
+  uint32 num_cells;
+  const void **cells = GridTr_grid_get_all_grid_cells(&g, &num_cells);
+  bool exact = num_cells > 0;
+  for (uint32 i = 0; i < num_cells; i++) {
+    const struct GridTr_grid_cell_s *cell = cells[i];
+    exact = exact && cell->num_colliders == cell->_max_colliders_;
+  }
+  ASSERT_TRUE(exact);
+  GridTr_free(cells);
+  GridTr_destroy_grid(&g);
+
+  // on top of colliders already in the grid, lists append in order
+  GridTr_create_grid(&g, 1.0f);
+  for (uint32 i = 0; i < head; i++)
+    GridTr_add_collider_to_grid(&g, &colls[i]);
+  GridTr_build_grid(&g, colls + head, n - head);
+  GridTr_build_grid(&g, NULL, 0);
+  ASSERT_EQ_U(g.colliders->num_elems, n);
+  ASSERT_TRUE(grid_same_cells(&ref, &g));
+
+  grid_free_colliders(colls, n);
+  GridTr_destroy_grid(&ref);
+  GridTr_destroy_grid(&g);
+}
+
+static bool grid_cell_has(const struct GridTr_grid_cell_s *cell, uint32 idx) {
+  for (uint32 i = 0; cell && i < cell->num_colliders; i++)
+    if (cell->colliders[i] == idx)
+      return true;
+  return false;
+}
+
+static bool grid_count_cell(const struct GridTr_grid_cell_s *cell,
+                            void *user_data) {
+  (void)cell;
+  (*(uint32 *)user_data)++;
+  return false;
+}
+
+void grid_test_remove_and_update() {
+  const uint32 n = 300;
+  struct GridTr_collider_s *colls = grid_make_random_tris(n);
+  struct GridTr_grid_s ref, g;
+  GridTr_create_grid(&ref, 1.0f);
+  GridTr_create_grid(&g, 1.0f);
+  for (uint32 i = 0; i < n; i++) {
+    GridTr_add_collider_to_grid(&ref, &colls[i]);
+    GridTr_add_collider_to_grid(&g, &colls[i]);
+  }
+  for (uint32 i = 0; i < n; i += 3)
+    ASSERT_TRUE(GridTr_grid_remove_collider(&g, i));
+  ASSERT_FALSE(GridTr_grid_remove_collider(&g, 0));
+  ASSERT_FALSE(GridTr_grid_remove_collider(&g, n));
+
+  // every cell is the full build's cell minus the removed colliders, and
+  // cells left with nothing are gone along with their occupancy bit
+  uint32 num_ref;
+  const void **cells = GridTr_grid_get_all_grid_cells(&ref, &num_ref);
+  bool same = true;
+  for (uint32 i = 0; i < num_ref; i++) {
+    const struct GridTr_grid_cell_s *a = cells[i];
+    const struct GridTr_grid_cell_s *b =
+        GridTr_grid_get_grid_cell_ro(&g, a->crl);
+    uint32 kept = 0;
+    for (uint32 k = 0; k < a->num_colliders; k++) {
+      if (a->colliders[k] % 3 == 0)
+        continue;
+      same = same && b && kept < b->num_colliders &&
+             b->colliders[kept] == a->colliders[k];
+      kept++;
+    }
+    same = same && (kept ? b && b->num_colliders == kept : b == NULL);
+    same = same && GridTr_grid_cell_occupied(&g, a->crl) == (kept > 0);
+  }
+  ASSERT_TRUE(same);
+  GridTr_free(cells);
+
+  // a range far past the scene only visits the occupied cells
+  struct ivec3_s far_min = ivec3_set(-(1 << 20), -(1 << 20), -(1 << 20));
+  struct ivec3_s far_max = ivec3_set(1 << 20, 1 << 20, 1 << 20);
+  uint32 num_visited = 0;
+  GridTr_grid_visit_cells(&ref, far_min, far_max, grid_count_cell,
+                          &num_visited);
+  ASSERT_EQ_U(num_visited, num_ref);
+
+  // adds reuse the freed slots
+  GridTr_add_collider_to_grid(&g, &colls[0]);
+  ASSERT_EQ_U(g.colliders->num_elems, n);
+
+  // moving a collider leaves it in exactly the cells of its new footprint
+  const struct GridTr_collider_s *src = &colls[1];
+  struct vec3_s ps[3];
+  for (int k = 0; k < 3; k++)
+    ps[k] = vec3_add(src->ps[k], vec3_set(0.0f, 0.0f, 25.0f));
+  struct GridTr_collider_s moved;
+  GridTr_create_collider(&moved, 1, ps, 3, GridTr_create_plane(src->plane.n, ps[0]));
+  ASSERT_TRUE(GridTr_grid_update_collider(&g, 1, &moved));
+  struct GridTr_grid_s h;
+  GridTr_create_grid(&h, 1.0f);
+  GridTr_add_collider_to_grid(&h, &moved);
+  uint32 num_h, num_g, with_idx = 0;
+  const void **h_cells = GridTr_grid_get_all_grid_cells(&h, &num_h);
+  for (uint32 i = 0; i < num_h; i++) {
+    const struct GridTr_grid_cell_s *c = h_cells[i];
+    ASSERT_TRUE(grid_cell_has(GridTr_grid_get_grid_cell_ro(&g, c->crl), 1));
+  }
+  cells = GridTr_grid_get_all_grid_cells(&g, &num_g);
+  for (uint32 i = 0; i < num_g; i++)
+    with_idx += grid_cell_has(cells[i], 1) ? 1 : 0;
+  ASSERT_EQ_U(with_idx, num_h);
+  GridTr_free(cells);
+  GridTr_free(h_cells);
+  GridTr_destroy_grid(&h);
+
+  // emptying the grid leaves no cells and no occupancy
+  for (uint32 i = 0; i < n; i++)
+    GridTr_grid_remove_collider(&g, i);
+  ASSERT_EQ_U(g.cell_table->total_elems, 0);
+  ASSERT_EQ_U(g.brick_table->total_elems, 0);
+  ASSERT_EQ_U(g.macro_table->total_elems, 0);
+  ASSERT_TRUE(g.occ_min.x > g.occ_max.x);
+  num_visited = 0;
+  GridTr_grid_visit_cells(&g, far_min, far_max, grid_count_cell,
+                          &num_visited);
+  ASSERT_EQ_U(num_visited, 0);
+
+  GridTr_grid_freeze(&ref);
+  ASSERT_FALSE(GridTr_grid_remove_collider(&ref, 1));
+  ASSERT_FALSE(GridTr_grid_update_collider(&ref, 1, &moved));
+
+  GridTr_destroy_collider(&moved);
+  grid_free_colliders(colls, n);
+  GridTr_destroy_grid(&ref);
+  GridTr_destroy_grid(&g);
+}
+
+void grid_test_collider_pool() {
+  const uint32 n = 400;
+  struct GridTr_collider_s *colls = grid_make_random_tris(n);
+  struct GridTr_grid_s ref, g;
+  GridTr_create_grid(&ref, 1.0f);
+  GridTr_create_grid(&g, 1.0f);
+  GridTr_build_grid(&ref, colls, n);
+
+  // one at a time, then churn: every round drops a third and adds it back,
+  // so dead edges pile up and the pool has to pack itself more than once
+  for (uint32 i = 0; i < n; i++)
+    GridTr_add_collider_to_grid(&g, &colls[i]);
+  for (uint32 round = 0; round < 6; round++) {
+    for (uint32 i = round % 3; i < n; i += 3)
+      ASSERT_TRUE(GridTr_grid_remove_collider(&g, i));
+    for (uint32 i = round % 3; i < n; i += 3)
+      GridTr_add_collider_to_grid(&g, &colls[i]);
+    for (uint32 i = (round + 1) % 3; i < n; i += 3)
+      ASSERT_TRUE(GridTr_grid_update_collider(&g, i, &colls[i]));
+  }
+  ASSERT_EQ_U(g.colliders->num_elems, n);
+  // live edges plus at most the slack from the last pack
+  ASSERT_TRUE(g.collider_pool.max_edges <= 3 * n * 2);
+
+  bool same = true, pooled = true;
+  for (uint32 i = 0; i < n; i++) {
+    const struct GridTr_collider_s *c = GridTr_array_get(g.colliders, i);
+    pooled = pooled && c->pooled &&
+             c->ps == g.collider_pool.ps + c->pool_offset;
+    // freed slots are handed out again in any order
+    same = same && c->poly_id < n &&
+           collide_same_collider(c, &colls[c->poly_id]);
+  }
+  ASSERT_TRUE(pooled);
+  ASSERT_TRUE(same);
+  for (uint32 i = 0; i < n; i++) {
+    const struct GridTr_collider_s *c = GridTr_array_get(ref.colliders, i);
+    same = same && c->pooled && collide_same_collider(c, &colls[i]);
+  }
+  ASSERT_TRUE(same);
+
+  grid_free_colliders(colls, n);
+  GridTr_destroy_grid(&ref);
+  GridTr_destroy_grid(&g);
+}
+
+void grid_test_remove_dense() {
+  struct GridTr_collider_s *colls = grid_make_random_tris(2);
+  struct GridTr_aabb_s bounds;
+  GridTr_aabb_init(&bounds, vec3_set(-12.0f, -12.0f, -12.0f),
+                   vec3_set(12.0f, 12.0f, 12.0f));
+  struct GridTr_grid_s g;
+  GridTr_create_grid_dense(&g, 1.0f, &bounds);
+  GridTr_add_collider_to_grid(&g, &colls[0]);
+  struct ivec3_s crl = GridTr_get_grid_cell_for_p(colls[0].ps[0], 1.0f);
+  ASSERT_TRUE(GridTr_grid_get_grid_cell_ro(&g, crl) != NULL);
+  ASSERT_TRUE(GridTr_grid_remove_collider(&g, 0));
+  ASSERT_TRUE(GridTr_grid_get_grid_cell_ro(&g, crl) == NULL);
+  ASSERT_FALSE(GridTr_grid_cell_occupied(&g, crl));
+  grid_free_colliders(colls, 2);
+  GridTr_destroy_grid(&g);
+}
+
+void grid_test_suggest_cell_size() {
+  const uint32 n = 1500;
+  struct GridTr_collider_s *colls = grid_make_random_tris(n);
+  float s = GridTr_suggest_cell_size(colls, n, NULL);
+  // edges run 1..3 units, anything outside of this is a broken model
+  ASSERT_TRUE(s > 0.25f && s < 3.0f);
+  ASSERT_FEQ(GridTr_suggest_cell_size(NULL, 0, NULL), 1.0f);
+  // colliders without points, first or only, have nothing to read
+  struct GridTr_collider_s empty[2] = {{0}, {0}};
+  ASSERT_FEQ(GridTr_suggest_cell_size(empty, 2, NULL), 1.0f);
+  struct GridTr_collider_s saved = colls[0];
+  colls[0] = empty[0];
+  float se = GridTr_suggest_cell_size(colls, n, NULL);
+  ASSERT_TRUE(se > 0.25f && se < 3.0f);
+  colls[0] = saved;
+
+  // tighter budgets give coarser cells, and the build stays within budget
+  float prev = s;
+  for (uint64 budget = 1 << 22; budget >= 1 << 16; budget >>= 2) {
+    struct GridTr_cell_size_target_s target = {GridTr_CELL_SIZE_MEMORY_BUDGET,
+                                               budget};
+    float sb = GridTr_suggest_cell_size(colls, n, &target);
+    ASSERT_TRUE(sb >= prev);
+    prev = sb;
+    struct GridTr_grid_s g;
+    GridTr_create_grid(&g, sb);
+    GridTr_build_grid(&g, colls, n);
+    uint32 num_cells;
+    const void **cells = GridTr_grid_get_all_grid_cells(&g, &num_cells);
+    uint64 mem = (uint64)num_cells * (sizeof(struct GridTr_grid_cell_s) +
+                                      sizeof(struct GridTr_hash_table_entry_s));
+    for (uint32 i = 0; i < num_cells; i++)
+      mem += ((const struct GridTr_grid_cell_s *)cells[i])->num_colliders *
+             sizeof(uint32);
+    ASSERT_TRUE(mem <= budget);
+    GridTr_free(cells);
+    GridTr_destroy_grid(&g);
+  }
+
+  // auto sized grids pick it on their first build, adds before that are
+  // refused
+  struct GridTr_grid_s g;
+  GridTr_create_grid(&g, GridTr_CELL_SIZE_AUTO);
+  struct GridTr_rayseg_s seg =
+      GridTr_create_rayseg(vec3_set(0.0f, 0.0f, -20.0f), vec3_set(0.0f, 0.0f, 20.0f));
+  struct GridTr_hit_s hit;
+  ASSERT_FALSE(GridTr_raycast_closest(&g, &seg, &hit));
+  ASSERT_EQ_U(GridTr_add_collider_to_grid(&g, &colls[0]), UINT32_MAX);
+  ASSERT_EQ_U(g.colliders->num_elems, 0);
+  GridTr_build_grid(&g, colls, n);
+  ASSERT_FEQ(g.cell_size, s);
+  ASSERT_TRUE(GridTr_raycast_closest(&g, &seg, &hit));
+  GridTr_destroy_grid(&g);
+
+  // bad sizes fall back to auto, dense grids can't size themselves
+  GridTr_create_grid(&g, -1.0f);
+  ASSERT_FEQ(g.cell_size, GridTr_CELL_SIZE_AUTO);
+  GridTr_destroy_grid(&g);
+  GridTr_create_grid(&g, NAN);
+  ASSERT_FEQ(g.cell_size, GridTr_CELL_SIZE_AUTO);
+  GridTr_destroy_grid(&g);
+  struct GridTr_aabb_s bounds;
+  GridTr_aabb_init(&bounds, vec3_set(-12.0f, -12.0f, -12.0f),
+                   vec3_set(12.0f, 12.0f, 12.0f));
+  GridTr_create_grid_dense(&g, GridTr_CELL_SIZE_AUTO, &bounds);
+  ASSERT_TRUE(g.dense_cells == NULL);
+  GridTr_destroy_grid(&g);
+
+  grid_free_colliders(colls, n);
+}
+
+void grid_test_voxelize_matches_box() {
+  const uint32 num_tris = 300, n = num_tris + 60;
+  struct GridTr_collider_s *colls = grid_make_random_polys(num_tris, 60);
+
+  struct GridTr_grid_s ref, g, bulk;
+  GridTr_create_grid(&ref, 1.0f);
+  GridTr_create_grid(&g, 1.0f);
+  GridTr_create_grid(&bulk, 1.0f);
+  ASSERT_EQ_U(g.insert_mode, GridTr_INSERT_VOXELIZE);
+  ref.insert_mode = GridTr_INSERT_BOX;
+  for (uint32 i = 0; i < n; i++) {
+    GridTr_add_collider_to_grid(&ref, &colls[i]);
+    GridTr_add_collider_to_grid(&g, &colls[i]);
+  }
+  struct GridTr_thread_pool_s *pool = GridTr_create_thread_pool(3);
+  GridTr_build_grid_parallel(pool, &bulk, colls, n);
+  GridTr_destroy_thread_pool(&pool);
+  ASSERT_TRUE(grid_same_cells(&ref, &g));
+  ASSERT_TRUE(grid_same_cells(&ref, &bulk));
+
+  // removal still finds every cell a voxelized polygon went to
+  ASSERT_TRUE(GridTr_grid_remove_collider(&g, n - 2));
+  ASSERT_TRUE(GridTr_grid_remove_collider(&ref, n - 2));
+  ASSERT_TRUE(grid_same_cells(&ref, &g));
+
+  grid_free_colliders(colls, n);
+  GridTr_destroy_grid(&ref);
+  GridTr_destroy_grid(&g);
+  GridTr_destroy_grid(&bulk);
+}
+
 void run_grid_tests() {
   printf("[grid] begin tests:\n");
   test_create_and_destroy_grid();
@@ -274,5 +983,17 @@ void run_grid_tests() {
   grid_test_add_single_collider();
   grid_test_add_multiple_colliders();
   grid_test_march_through_grid();
+  grid_test_walk_cells();
+  grid_test_skip_empty_cells();
+  grid_test_dense_matches_sparse();
+  grid_test_freeze();
+  grid_test_morton_keys();
+  grid_test_build_parallel();
+  grid_test_bulk_build();
+  grid_test_voxelize_matches_box();
+  grid_test_remove_and_update();
+  grid_test_collider_pool();
+  grid_test_remove_dense();
+  grid_test_suggest_cell_size();
   printf("[grid] tests run: %d, failed: %d\n", g_tests_run, g_tests_failed);
 }
\ No newline at end of file
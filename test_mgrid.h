@@ -0,0 +1,178 @@
+#include "mgrid.h"
+#include "testing.h"
+
+extern int g_tests_run;
+extern int g_tests_failed;
+
+static void mgrid_make_tri(struct GridTr_collider_s *coll, uint32 id,
+                           struct vec3_s o, float size) {
+  struct vec3_s ps[3];
+  ps[0] = o;
+  ps[1] = vec3_set(o.x + size, o.y, o.z + size * 0.25f);
+  ps[2] = vec3_set(o.x, o.y + size, o.z - size * 0.25f);
+  struct vec3_s n = vec3_cross(point_vec(ps[0], ps[1]), point_vec(ps[0], ps[2]));
+  GridTr_create_collider(coll, id, ps, 3, GridTr_create_plane(n, ps[0]));
+}
+
+// clutter of small triangles over a few huge floor triangles
+static struct GridTr_collider_s *mgrid_make_scene(uint32 *n) {
+  const uint32 num_small = 400, num_big = 6;
+  *n = num_small + num_big;
+  struct GridTr_collider_s *colls =
+      GridTr_new(*n * sizeof(struct GridTr_collider_s));
+  uint32 rng = 99;
+  for (uint32 i = 0; i < num_small; i++) {
+    struct vec3_s o = vec3_set(test_randf(&rng, -30.0f, 30.0f),
+                               test_randf(&rng, -30.0f, 30.0f),
+                               test_randf(&rng, -5.0f, 5.0f));
+    mgrid_make_tri(&colls[i], i, o, test_randf(&rng, 0.3f, 1.5f));
+  }
+  for (uint32 i = 0; i < num_big; i++) {
+    struct vec3_s o = vec3_set(-32.0f + (float)i * 3.0f, -32.0f,
+                               -8.0f + (float)i * 3.0f);
+    mgrid_make_tri(&colls[num_small + i], num_small + i, o, 64.0f);
+  }
+  return colls;
+}
+
+static uint32 mgrid_count_cell_refs(const struct GridTr_grid_s *g) {
+  uint32 num_cells, total = 0;
+  const void **cells = GridTr_grid_get_all_grid_cells(g, &num_cells);
+  for (uint32 i = 0; i < num_cells; i++)
+    total += ((const struct GridTr_grid_cell_s *)cells[i])->num_colliders;
+  GridTr_free(cells);
+  return total;
+}
+
+static void test_mgrid_levels(void) {
+  struct GridTr_mgrid_s m;
+  GridTr_create_mgrid(&m, 1.0f, 4, 3);
+  ASSERT_EQ_U(m.num_levels, 3);
+  struct GridTr_collider_s small, medium, big;
+  mgrid_make_tri(&small, 0, vec3_set(0.2f, 0.2f, 0.5f), 0.5f);
+  mgrid_make_tri(&medium, 1, vec3_set(0.5f, 0.5f, 0.5f), 5.0f);
+  mgrid_make_tri(&big, 2, vec3_set(0.5f, 0.5f, 0.5f), 500.0f);
+  ASSERT_EQ_U(GridTr_mgrid_level_for_collider(&m, &small), 0);
+  ASSERT_EQ_U(GridTr_mgrid_level_for_collider(&m, &medium), 1);
+  ASSERT_EQ_U(GridTr_mgrid_level_for_collider(&m, &big), 2);
+
+  // no auto sizing for mgrids: no levels, adds refused
+  struct GridTr_mgrid_s bad;
+  GridTr_create_mgrid(&bad, GridTr_CELL_SIZE_AUTO, 4, 3);
+  ASSERT_EQ_U(bad.num_levels, 0);
+  ASSERT_EQ_U(GridTr_add_collider_to_mgrid(&bad, &small), UINT32_MAX);
+  GridTr_destroy_mgrid(&bad);
+
+  ASSERT_EQ_U(GridTr_add_collider_to_mgrid(&m, &big), 0);
+  ASSERT_EQ_U(GridTr_add_collider_to_mgrid(&m, &small), 1);
+  ASSERT_EQ_U(m.levels[0].colliders->num_elems, 1);
+  ASSERT_EQ_U(m.levels[2].colliders->num_elems, 1);
+  ASSERT_EQ_U(GridTr_mgrid_get_collider(&m, 0)->poly_id, 2);
+  ASSERT_EQ_U(GridTr_mgrid_get_collider(&m, 1)->poly_id, 0);
+  ASSERT_TRUE(GridTr_mgrid_get_collider(&m, 2) == NULL);
+
+  // removed indices stay dead, even once the next add reuses their slot
+  ASSERT_EQ_U(GridTr_add_collider_to_mgrid(&m, &small), 2);
+  ASSERT_TRUE(GridTr_mgrid_remove_collider(&m, 1));
+  ASSERT_FALSE(GridTr_mgrid_remove_collider(&m, 1));
+  ASSERT_FALSE(GridTr_mgrid_remove_collider(&m, 4));
+  ASSERT_TRUE(GridTr_mgrid_get_collider(&m, 1) == NULL);
+  GridTr_destroy_collider(&small);
+  mgrid_make_tri(&small, 3, vec3_set(3.2f, 0.2f, 0.5f), 0.5f);
+  ASSERT_EQ_U(GridTr_add_collider_to_mgrid(&m, &small), 3);
+  ASSERT_EQ_U(m.levels[0].colliders->num_elems, 2);
+  ASSERT_TRUE(GridTr_mgrid_get_collider(&m, 1) == NULL);
+  ASSERT_EQ_U(GridTr_mgrid_get_collider(&m, 2)->poly_id, 0);
+  ASSERT_EQ_U(GridTr_mgrid_get_collider(&m, 3)->poly_id, 3);
+  struct GridTr_rayseg_s seg = GridTr_create_rayseg(
+      vec3_set(3.3f, 0.3f, 5.0f), vec3_set(3.3f, 0.3f, -5.0f));
+  struct GridTr_hit_s hit;
+  ASSERT_TRUE(GridTr_mgrid_raycast_closest(&m, &seg, &hit));
+  ASSERT_EQ_U(hit.collider_idx, 3);
+
+  // a frozen level would leave refs behind, the build refuses up front
+  GridTr_grid_freeze(&m.levels[1]);
+  GridTr_build_mgrid(&m, &medium, 1);
+  ASSERT_EQ_U(m.num_colliders, 4);
+  ASSERT_EQ_U(m.refs->num_elems, 4);
+
+  GridTr_destroy_collider(&small);
+  GridTr_destroy_collider(&medium);
+  GridTr_destroy_collider(&big);
+  GridTr_destroy_mgrid(&m);
+}
+
+static void test_mgrid_raycast_matches_single_grid(void) {
+  uint32 n;
+  struct GridTr_collider_s *colls = mgrid_make_scene(&n);
+  struct GridTr_grid_s g;
+  GridTr_create_grid(&g, 1.0f);
+  GridTr_build_grid(&g, colls, n);
+  struct GridTr_mgrid_s m;
+  GridTr_create_mgrid(&m, 1.0f, 4, 4);
+  GridTr_build_mgrid(&m, colls, n);
+  ASSERT_EQ_U(m.num_colliders, n);
+
+  // the big floors no longer fill thousands of fine cells
+  uint32 single_refs = mgrid_count_cell_refs(&g), multi_refs = 0;
+  for (uint32 l = 0; l < m.num_levels; l++)
+    multi_refs += mgrid_count_cell_refs(&m.levels[l]);
+  ASSERT_TRUE(multi_refs * 4 < single_refs);
+
+  // sized for the whole scene, the floors drag a single grid's cells up to
+  // where the clutter piles into them
+  struct GridTr_grid_s g_auto;
+  GridTr_create_grid(&g_auto, GridTr_CELL_SIZE_AUTO);
+  GridTr_build_grid(&g_auto, colls, n);
+
+  uint32 rng = 4242;
+  int hits = 0;
+  bool same = true;
+  uint32 single_tests = 0, auto_tests = 0, multi_tests = 0;
+  for (int i = 0; i < 1000; i++) {
+    struct vec3_s p0 = vec3_set(test_randf(&rng, -30.0f, 30.0f),
+                                test_randf(&rng, -30.0f, 30.0f),
+                                test_randf(&rng, -10.0f, 10.0f));
+    struct vec3_s p1 = vec3_set(test_randf(&rng, -30.0f, 30.0f),
+                                test_randf(&rng, -30.0f, 30.0f),
+                                test_randf(&rng, -10.0f, 10.0f));
+    struct GridTr_rayseg_s seg = GridTr_create_rayseg(p0, p1);
+    struct GridTr_hit_s a, b;
+    bool ga = GridTr_raycast_closest_counted(&g, &seg, &a, &single_tests);
+    bool gb = GridTr_mgrid_raycast_closest_counted(&m, &seg, &b, &multi_tests);
+    same = same && ga == gb && GridTr_mgrid_raycast_any(&m, &seg) == ga;
+    struct GridTr_hit_s c;
+    same = same &&
+           GridTr_raycast_closest_counted(&g_auto, &seg, &c, &auto_tests) == ga;
+    if (ga && gb) {
+      // mgrid indices follow build order, like the single grid's
+      const struct GridTr_collider_s *c =
+          GridTr_mgrid_get_collider(&m, b.collider_idx);
+      float t;
+      same = same && fabsf(a.t - b.t) <= TOL && c &&
+             GridTr_rayseg_isect_collider(c, &seg, &t);
+      hits++;
+    }
+  }
+  ASSERT_TRUE(same);
+  ASSERT_TRUE(hits > 100);
+  // the fine grid tests the fewest polygons but holds 4x the refs. the
+  // mgrid tests each floor once per ray, still far below the auto sized
+  // grid with its clutter piled into cells the floors sized
+  ASSERT_TRUE(single_tests < multi_tests);
+  ASSERT_TRUE(multi_tests * 3 < auto_tests);
+
+  for (uint32 i = 0; i < n; i++)
+    GridTr_destroy_collider(&colls[i]);
+  GridTr_free(colls);
+  GridTr_destroy_grid(&g);
+  GridTr_destroy_grid(&g_auto);
+  GridTr_destroy_mgrid(&m);
+}
+
+void run_mgrid_tests() {
+  printf("[mgrid] begin tests:\n");
+  test_mgrid_levels();
+  test_mgrid_raycast_matches_single_grid();
+  printf("[mgrid] tests run: %d, failed: %d\n", g_tests_run, g_tests_failed);
+}
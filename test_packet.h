@@ -0,0 +1,171 @@
+#include "packet.h"
+#include "testing.h"
+
+extern int g_tests_run;
+extern int g_tests_failed;
+
+static void test_packet_isect_collider(void) {
+  // quad on x = 5, y and z in [0, 2]
+  struct vec3_s ps[4] = {{{{5.0f, 0.0f, 0.0f}}},
+                         {{{5.0f, 2.0f, 0.0f}}},
+                         {{{5.0f, 2.0f, 2.0f}}},
+                         {{{5.0f, 0.0f, 2.0f}}}};
+  struct GridTr_collider_s coll;
+  GridTr_create_collider(
+      &coll, 0, ps, 4,
+      GridTr_create_plane(vec3_set(1.0f, 0.0f, 0.0f), ps[0]));
+
+  // lane i starts at y = i * 0.5 - 0.75, so lanes 2..5 are in front of the
+  // quad (as far as the packet goes)
+  struct GridTr_ray_packet_s packet;
+  float o[GridTr_PACKET_SIZE], y[GridTr_PACKET_SIZE], one[GridTr_PACKET_SIZE],
+      zero[GridTr_PACKET_SIZE], len[GridTr_PACKET_SIZE];
+  for (uint32 i = 0; i < GridTr_PACKET_SIZE; i++) {
+    o[i] = (float)i * 0.25f;
+    y[i] = (float)i * 0.5f - 0.75f;
+    one[i] = 1.0f;
+    zero[i] = 0.0f;
+    len[i] = 10.0f;
+  }
+  GridTr_ray_packet_load(&packet, o, y, one, one, zero, zero, len,
+                         GridTr_PACKET_SIZE);
+  _Alignas(GridTr_SIMD_ALIGN) float t[GridTr_PACKET_SIZE];
+  uint32 idx[GridTr_PACKET_SIZE];
+  for (uint32 i = 0; i < GridTr_PACKET_SIZE; i++) {
+    t[i] = FLT_MAX;
+    idx[i] = UINT32_MAX;
+  }
+  // lane 3 is left out
+  uint32 lanes = ((1u << GridTr_PACKET_SIZE) - 1) & ~(1u << 3);
+  uint32 hit = GridTr_packet_isect_collider(&coll, &packet, lanes, 7, t, idx);
+  ASSERT_EQ_U(hit, ((1u << 2) | (1u << 4) | (1u << 5)) &
+                       ((1u << GridTr_PACKET_SIZE) - 1));
+  bool same = true;
+  for (uint32 i = 0; i < GridTr_PACKET_SIZE; i++) {
+    struct GridTr_rayseg_s seg = GridTr_create_rayseg(
+        vec3_set(o[i], y[i], 1.0f), vec3_set(o[i] + 10.0f, y[i], 1.0f));
+    float ref_t;
+    bool ref = (lanes & (1u << i)) &&
+               GridTr_rayseg_isect_collider(&coll, &seg, &ref_t);
+    same = same && ((hit >> i) & 1) == (ref ? 1u : 0u);
+    same = same && (ref ? t[i] == ref_t && idx[i] == 7
+                        : t[i] == FLT_MAX && idx[i] == UINT32_MAX);
+  }
+  ASSERT_TRUE(same);
+  // only closer hits count
+  ASSERT_EQ_U(GridTr_packet_isect_collider(&coll, &packet, lanes, 8, t, idx),
+              0);
+  GridTr_destroy_collider(&coll);
+}
+
+static void packet_check_batch(const struct GridTr_grid_s *g, const float *soa,
+                               uint32 n) {
+  struct GridTr_batch_hit_s *ref = GridTr_new(n * sizeof(*ref));
+  struct GridTr_batch_hit_s *got = GridTr_new(n * sizeof(*got));
+  uint32 ref_hits =
+      GridTr_trace_batch(g, soa, soa + n, soa + 2 * n, soa + 3 * n,
+                         soa + 4 * n, soa + 5 * n, soa + 6 * n, n, ref);
+  uint32 got_hits =
+      GridTr_trace_batch_packets(g, soa, soa + n, soa + 2 * n, soa + 3 * n,
+                                 soa + 4 * n, soa + 5 * n, soa + 6 * n, n, got);
+  ASSERT_EQ_U(got_hits, ref_hits);
+  ASSERT_TRUE(ref_hits > 0);
+  ASSERT_TRUE(memcmp(got, ref, n * sizeof(*ref)) == 0);
+  GridTr_free(got);
+  GridTr_free(ref);
+}
+
+static void test_raycast_packet_matches_batch(void) {
+  // stacked triangles (see test_grid.h), rays along z cross several
+  struct GridTr_collider_s *colls = grid_make_random_tris(1024);
+  struct GridTr_grid_s g;
+  GridTr_create_grid(&g, 1.0f);
+  GridTr_build_grid(&g, colls, 1024);
+  grid_free_colliders(colls, 1024);
+
+  // not a multiple of any packet size, the last packet is partial
+  const uint32 n = 1003;
+  float *soa = GridTr_new(7 * n * sizeof(float));
+  uint32 rng = 2024;
+  for (int coherent = 0; coherent < 2; coherent++) {
+    struct vec3_s eye = vec3_set(0.5f, 0.5f, -12.0f);
+    for (uint32 i = 0; i < n; i++) {
+      struct vec3_s p0, p1;
+      if (coherent) {
+        // a fan from one eye, like a block of camera rays
+        p0 = eye;
+        p1 = vec3_set((float)(i % 32) * 0.25f - 4.0f,
+                      (float)(i / 32) * 0.25f - 4.0f, 12.0f);
+      } else {
+        p0 = vec3_set(test_randf(&rng, -8.0f, 8.0f),
+                      test_randf(&rng, -8.0f, 8.0f),
+                      test_randf(&rng, -12.0f, 12.0f));
+        p1 = vec3_set(test_randf(&rng, -8.0f, 8.0f),
+                      test_randf(&rng, -8.0f, 8.0f),
+                      test_randf(&rng, -12.0f, 12.0f));
+      }
+      struct GridTr_rayseg_s seg = GridTr_create_rayseg(p0, p1);
+      for (int k = 0; k < 3; k++) {
+        soa[k * n + i] = seg.o.xyz[k];
+        soa[(3 + k) * n + i] = seg.d.xyz[k];
+      }
+      soa[6 * n + i] = seg.len;
+    }
+    packet_check_batch(&g, soa, n);
+  }
+  GridTr_free(soa);
+  GridTr_destroy_grid(&g);
+}
+
+static void test_tri_packets_match_polygons(void) {
+  // the polygons get fan-triangulated, their diagonals must not leak or
+  // drop hits
+  const uint32 n_colls = 1024 + 60;
+  struct GridTr_collider_s *colls = grid_make_random_polys(1024, 60);
+  struct GridTr_grid_s ref, g;
+  GridTr_create_grid(&ref, 1.0f);
+  GridTr_build_grid(&ref, colls, n_colls);
+  GridTr_create_grid(&g, 1.0f);
+  GridTr_build_grid(&g, colls, n_colls);
+  grid_free_colliders(colls, n_colls);
+  ASSERT_TRUE(GridTr_grid_build_tri_packets(&g));
+  ASSERT_TRUE(g.tri_packets != NULL && g.num_tri_packets > 0);
+
+  uint32 rng = 99, hits = 0, same = 0;
+  const uint32 n = 2000;
+  for (uint32 i = 0; i < n; i++) {
+    struct vec3_s p0 = vec3_set(test_randf(&rng, -8.0f, 8.0f),
+                                test_randf(&rng, -8.0f, 8.0f),
+                                test_randf(&rng, -12.0f, 12.0f));
+    struct vec3_s p1 = vec3_set(test_randf(&rng, -8.0f, 8.0f),
+                                test_randf(&rng, -8.0f, 8.0f),
+                                test_randf(&rng, -12.0f, 12.0f));
+    struct GridTr_rayseg_s seg = GridTr_create_rayseg(p0, p1);
+    struct GridTr_hit_s a, b;
+    bool hit_a = GridTr_raycast_closest(&ref, &seg, &a);
+    bool hit_b = GridTr_raycast_closest(&g, &seg, &b);
+    // same tests as the polygons, so the very same hits
+    if (hit_a == hit_b && (!hit_a || memcmp(&a, &b, sizeof(a)) == 0))
+      same++;
+    hits += hit_a;
+  }
+  ASSERT_TRUE(hits > 0);
+  ASSERT_EQ_U(same, n);
+
+  // frozen grids keep the packets, changes drop them
+  ASSERT_TRUE(GridTr_grid_freeze(&ref));
+  ASSERT_TRUE(GridTr_grid_build_tri_packets(&ref));
+  ASSERT_EQ_U(ref.num_tri_packets, g.num_tri_packets);
+  ASSERT_TRUE(GridTr_grid_remove_collider(&g, 0));
+  ASSERT_TRUE(g.tri_packets == NULL);
+  GridTr_destroy_grid(&g);
+  GridTr_destroy_grid(&ref);
+}
+
+void run_packet_tests() {
+  printf("[packet] begin tests:\n");
+  test_packet_isect_collider();
+  test_raycast_packet_matches_batch();
+  test_tri_packets_match_polygons();
+  printf("[packet] tests run: %d, failed: %d\n", g_tests_run, g_tests_failed);
+}
@@ -0,0 +1,103 @@
+#include "pool.h"
+#include "testing.h"
+#include <stdatomic.h>
+
+extern int g_tests_run;
+extern int g_tests_failed;
+
+struct pool_test_ctx_s {
+  uint32 *visits;      // per task
+  uint64 sums[8];      // per worker
+  uint32 max_worker;
+  atomic_uint calls;
+};
+
+static void pool_test_task(void *ctx, uint32 task, uint32 worker) {
+  struct pool_test_ctx_s *c = ctx;
+  c->visits[task]++;
+  if (worker < 8)
+    c->sums[worker] += task;
+  if (worker > c->max_worker)
+    c->max_worker = worker; // racy, only ever compared against the size
+  atomic_fetch_add(&c->calls, 1);
+}
+
+static void test_thread_pool_runs_every_task(void) {
+  const uint32 num_tasks = 1000;
+  for (uint32 threads = 1; threads <= 4; threads += 3) {
+    struct GridTr_thread_pool_s *pool = GridTr_create_thread_pool(threads);
+    ASSERT_TRUE(pool != NULL);
+    ASSERT_EQ_U(GridTr_thread_pool_size(pool), threads);
+
+    struct pool_test_ctx_s c = {0};
+    c.visits = GridTr_new(num_tasks * sizeof(uint32));
+    memset(c.visits, 0, num_tasks * sizeof(uint32));
+    // the pool is reused across jobs
+    for (int job = 0; job < 3; job++) {
+      atomic_init(&c.calls, 0);
+      GridTr_thread_pool_run(pool, pool_test_task, &c, num_tasks);
+      ASSERT_EQ_U(atomic_load(&c.calls), num_tasks);
+    }
+    uint64 sum = 0;
+    for (int w = 0; w < 8; w++)
+      sum += c.sums[w];
+    ASSERT_TRUE(sum == 3ull * num_tasks * (num_tasks - 1) / 2);
+    bool once = true;
+    for (uint32 i = 0; i < num_tasks; i++)
+      once = once && c.visits[i] == 3;
+    ASSERT_TRUE(once);
+    ASSERT_TRUE(c.max_worker < threads);
+
+    // an empty job returns straight away
+    GridTr_thread_pool_run(pool, pool_test_task, &c, 0);
+    GridTr_free(c.visits);
+    GridTr_destroy_thread_pool(&pool);
+    ASSERT_TRUE(pool == NULL);
+  }
+}
+
+struct pool_steal_ctx_s {
+  uint32 share; // worker 0's starting share is [0, share)
+  atomic_uint visits;
+  atomic_bool helped;
+  atomic_bool timed_out;
+};
+
+static void pool_steal_task(void *ctx, uint32 task, uint32 worker) {
+  (void)worker;
+  struct pool_steal_ctx_s *c = ctx;
+  atomic_fetch_add(&c->visits, 1);
+  if (task > 0 && task < c->share)
+    atomic_store(&c->helped, true);
+  if (task != 0)
+    return;
+  // one very slow task: the rest of its share only moves on if another
+  // worker steals it
+  for (uint64 i = 0; !atomic_load(&c->helped); i++) {
+    if (i > (1ull << 32)) {
+      atomic_store(&c->timed_out, true);
+      break;
+    }
+  }
+}
+
+static void test_thread_pool_steals(void) {
+  const uint32 threads = 4, num_tasks = 1000;
+  struct GridTr_thread_pool_s *pool = GridTr_create_thread_pool(threads);
+  struct pool_steal_ctx_s c;
+  c.share = num_tasks / threads;
+  atomic_init(&c.visits, 0);
+  atomic_init(&c.helped, false);
+  atomic_init(&c.timed_out, false);
+  GridTr_thread_pool_run(pool, pool_steal_task, &c, num_tasks);
+  ASSERT_EQ_U(atomic_load(&c.visits), num_tasks);
+  ASSERT_FALSE(atomic_load(&c.timed_out));
+  GridTr_destroy_thread_pool(&pool);
+}
+
+void run_pool_tests() {
+  printf("[pool] begin tests:\n");
+  test_thread_pool_runs_every_task();
+  test_thread_pool_steals();
+  printf("[pool] tests run: %d, failed: %d\n", g_tests_run, g_tests_failed);
+}
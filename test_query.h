@@ -0,0 +1,732 @@
+#include "query.h"
+#include "testing.h"
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern int g_tests_run;
+extern int g_tests_failed;
+
+// axis aligned quad on plane x = x0, spanning [y0,y1] x [z0,z1]
+static void query_make_x_quad(struct GridTr_collider_s *coll, uint32 id,
+                              float x0, float y0, float y1, float z0,
+                              float z1) {
+  struct vec3_s ps[4];
+  ps[0] = vec3_set(x0, y0, z0);
+  ps[1] = vec3_set(x0, y1, z0);
+  ps[2] = vec3_set(x0, y1, z1);
+  ps[3] = vec3_set(x0, y0, z1);
+  struct vec3_s n =
+      vec3_cross(point_vec(ps[0], ps[1]), point_vec(ps[0], ps[2]));
+  GridTr_create_collider(coll, id, ps, 4, GridTr_create_plane(n, ps[0]));
+}
+
+static void query_build_walls(struct GridTr_grid_s *g) {
+  GridTr_create_grid(g, 1.0f);
+  struct GridTr_collider_s coll;
+  query_make_x_quad(&coll, 0, 10.0f, -2.0f, 2.0f, -2.0f, 2.0f);
+  GridTr_add_collider_to_grid(g, &coll);
+  GridTr_destroy_collider(&coll);
+  query_make_x_quad(&coll, 1, 5.5f, 0.0f, 2.0f, 0.0f, 2.0f);
+  GridTr_add_collider_to_grid(g, &coll);
+  GridTr_destroy_collider(&coll);
+}
+
+static void test_raycast_closest_walls(void) {
+  struct GridTr_grid_s g;
+  query_build_walls(&g);
+
+  struct GridTr_hit_s hit;
+  struct GridTr_rayseg_s seg = GridTr_create_rayseg(
+      vec3_set(0.25f, 0.5f, 0.5f), vec3_set(20.0f, 0.5f, 0.5f));
+  ASSERT_TRUE(GridTr_raycast_closest(&g, &seg, &hit));
+  ASSERT_EQ_U(hit.collider_idx, 1);
+  ASSERT_FEQ(hit.t, 5.25f);
+  ASSERT_V3EQ(hit.p, vec3_set(5.5f, 0.5f, 0.5f));
+  ASSERT_V3EQ(hit.n, vec3_set(-1.0f, 0.0f, 0.0f));
+
+  // below the small wall, only the big one is in the way
+  seg = GridTr_create_rayseg(vec3_set(0.25f, -0.5f, 0.5f),
+                             vec3_set(20.0f, -0.5f, 0.5f));
+  ASSERT_TRUE(GridTr_raycast_closest(&g, &seg, &hit));
+  ASSERT_EQ_U(hit.collider_idx, 0);
+  ASSERT_FEQ(hit.t, 9.75f);
+
+  // from behind, the normal flips towards the ray
+  seg = GridTr_create_rayseg(vec3_set(15.0f, -0.5f, 0.5f),
+                             vec3_set(0.0f, -0.5f, 0.5f));
+  ASSERT_TRUE(GridTr_raycast_closest(&g, &seg, &hit));
+  ASSERT_EQ_U(hit.collider_idx, 0);
+  ASSERT_V3EQ(hit.n, vec3_set(1.0f, 0.0f, 0.0f));
+
+  // too short, and parallel
+  seg = GridTr_create_rayseg(vec3_set(0.25f, 0.5f, 0.5f),
+                             vec3_set(5.0f, 0.5f, 0.5f));
+  ASSERT_FALSE(GridTr_raycast_closest(&g, &seg, &hit));
+  seg = GridTr_create_rayseg(vec3_set(0.25f, 0.5f, 0.5f),
+                             vec3_set(0.25f, 0.5f, 8.0f));
+  ASSERT_FALSE(GridTr_raycast_closest(&g, &seg, &hit));
+
+  GridTr_destroy_grid(&g);
+}
+
+// reference answer: test every collider in the grid
+static bool query_brute_closest(const struct GridTr_grid_s *g,
+                                const struct GridTr_rayseg_s *seg,
+                                float *best_t) {
+  bool found = false;
+  *best_t = FLT_MAX;
+  for (uint32 i = 0; i < g->colliders->num_elems; i++) {
+    const struct GridTr_collider_s *c = GridTr_array_get_ro(g->colliders, i);
+    float t;
+    if (GridTr_rayseg_isect_collider(c, seg, &t) && t < *best_t) {
+      *best_t = t;
+      found = true;
+    }
+  }
+  return found;
+}
+
+static void query_load_colliders_obj(struct GridTr_grid_s *g) {
+  struct GridTr_collider_s *colls = NULL;
+  uint32 n = 0;
+  GridTr_load_colliders_from_obj(&colls, &n, "colliders.obj");
+  GridTr_create_grid(g, 1.0f);
+  for (uint32 i = 0; i < n; i++) {
+    GridTr_add_collider_to_grid(g, &colls[i]);
+    GridTr_destroy_collider(&colls[i]);
+  }
+  GridTr_free(colls);
+}
+
+static void test_raycast_closest_matches_brute_force(void) {
+  struct GridTr_grid_s g;
+  query_load_colliders_obj(&g);
+
+  uint32 rng = 12345;
+  int hits = 0;
+  for (int i = 0; i < 2000; i++) {
+    struct vec3_s p0 = vec3_set(test_randf(&rng, -4.0f, 5.0f),
+                                test_randf(&rng, -2.0f, 4.0f),
+                                test_randf(&rng, -2.0f, 5.0f));
+    struct vec3_s p1 = vec3_set(test_randf(&rng, -4.0f, 5.0f),
+                                test_randf(&rng, -2.0f, 4.0f),
+                                test_randf(&rng, -2.0f, 5.0f));
+    struct GridTr_rayseg_s seg = GridTr_create_rayseg(p0, p1);
+    float ref_t;
+    bool ref = query_brute_closest(&g, &seg, &ref_t);
+    struct GridTr_hit_s hit;
+    bool got = GridTr_raycast_closest(&g, &seg, &hit);
+    ASSERT_EQ_I(got, ref);
+    if (got) {
+      ASSERT_FEQ(hit.t, ref_t);
+      hits++;
+    }
+  }
+  ASSERT_TRUE(hits > 0);
+  GridTr_destroy_grid(&g);
+}
+
+static void test_raycast_all(void) {
+  struct GridTr_grid_s g;
+  query_build_walls(&g);
+  struct GridTr_hit_s hits[64];
+  struct GridTr_rayseg_s seg = GridTr_create_rayseg(
+      vec3_set(0.25f, 0.5f, 0.5f), vec3_set(20.0f, 0.5f, 0.5f));
+  ASSERT_EQ_U(GridTr_raycast_all(&g, &seg, hits, 64), 2);
+  ASSERT_EQ_U(hits[0].collider_idx, 1);
+  ASSERT_FEQ(hits[0].t, 5.25f);
+  ASSERT_EQ_U(hits[1].collider_idx, 0);
+  ASSERT_FEQ(hits[1].t, 9.75f);
+  ASSERT_V3EQ(hits[1].n, vec3_set(-1.0f, 0.0f, 0.0f));
+  ASSERT_EQ_U(GridTr_raycast_all(&g, &seg, hits, 1), 1);
+  ASSERT_EQ_U(hits[0].collider_idx, 1);
+  GridTr_destroy_grid(&g);
+
+  // stacks of triangles, rays along z go through several
+  struct GridTr_collider_s *colls = grid_make_random_tris(1024);
+  GridTr_create_grid(&g, 1.0f);
+  GridTr_build_grid(&g, colls, 1024);
+  grid_free_colliders(colls, 1024);
+  uint32 rng = 4242;
+  bool same = true;
+  uint32 total = 0;
+  for (int i = 0; i < 1000; i++) {
+    struct vec3_s p0 = vec3_set(test_randf(&rng, -8.0f, 8.0f),
+                                test_randf(&rng, -8.0f, 8.0f), -12.0f);
+    struct vec3_s p1 = vec3_set(test_randf(&rng, -8.0f, 8.0f),
+                                test_randf(&rng, -8.0f, 8.0f), 12.0f);
+    seg = GridTr_create_rayseg(p0, p1);
+    // reference: every collider, sorted
+    float ref[64];
+    uint32 num_ref = 0;
+    for (uint32 k = 0; k < g.colliders->num_elems && num_ref < 64; k++) {
+      float t;
+      if (!GridTr_rayseg_isect_collider(GridTr_array_get_ro(g.colliders, k),
+                                        &seg, &t))
+        continue;
+      uint32 j = num_ref++;
+      for (; j > 0 && ref[j - 1] > t; j--)
+        ref[j] = ref[j - 1];
+      ref[j] = t;
+    }
+    uint32 n = GridTr_raycast_all(&g, &seg, hits, 64);
+    same = same && n == num_ref;
+    for (uint32 j = 0; j < n && j < num_ref; j++) {
+      same = same && fabsf(hits[j].t - ref[j]) < 1e-5f;
+      for (uint32 k = 0; k < j; k++)
+        same = same && hits[k].collider_idx != hits[j].collider_idx;
+    }
+    // a short buffer keeps the nearest
+    n = GridTr_raycast_all(&g, &seg, hits, 2);
+    same = same && n == MIN(num_ref, 2);
+    for (uint32 j = 0; j < n; j++)
+      same = same && fabsf(hits[j].t - ref[j]) < 1e-5f;
+    total += num_ref;
+  }
+  ASSERT_TRUE(same);
+  ASSERT_TRUE(total > 3000);
+  GridTr_destroy_grid(&g);
+}
+
+static void test_trace_batch(void) {
+  struct GridTr_grid_s g;
+  query_load_colliders_obj(&g);
+  enum { N = 1000 };
+  float *soa = GridTr_new(7 * N * sizeof(float));
+  float *ox = soa, *oy = soa + N, *oz = soa + 2 * N;
+  float *dx = soa + 3 * N, *dy = soa + 4 * N, *dz = soa + 5 * N;
+  float *len = soa + 6 * N;
+  struct GridTr_rayseg_s *segs =
+      GridTr_new(N * sizeof(struct GridTr_rayseg_s));
+  uint32 rng = 999;
+  for (int i = 0; i < N; i++) {
+    struct vec3_s p0 = vec3_set(test_randf(&rng, -4.0f, 5.0f),
+                                test_randf(&rng, -2.0f, 4.0f),
+                                test_randf(&rng, -2.0f, 5.0f));
+    struct vec3_s p1 = vec3_set(test_randf(&rng, -4.0f, 5.0f),
+                                test_randf(&rng, -2.0f, 4.0f),
+                                test_randf(&rng, -2.0f, 5.0f));
+    segs[i] = GridTr_create_rayseg(p0, p1);
+    ox[i] = segs[i].o.x, oy[i] = segs[i].o.y, oz[i] = segs[i].o.z;
+    dx[i] = segs[i].d.x, dy[i] = segs[i].d.y, dz[i] = segs[i].d.z;
+    len[i] = segs[i].len;
+  }
+  struct GridTr_batch_hit_s *hits =
+      GridTr_new(N * sizeof(struct GridTr_batch_hit_s));
+  uint32 num_hits =
+      GridTr_trace_batch(&g, ox, oy, oz, dx, dy, dz, len, N, hits);
+  uint32 ref_hits = 0;
+  bool same = true;
+  for (int i = 0; i < N; i++) {
+    struct GridTr_hit_s hit;
+    if (GridTr_raycast_closest(&g, &segs[i], &hit)) {
+      ref_hits++;
+      same = same && hits[i].collider_idx == hit.collider_idx &&
+             hits[i].t == hit.t &&
+             vec3_lensq(vec3_sub(hits[i].n, hit.n)) == 0.0f;
+    } else {
+      same = same && hits[i].collider_idx == UINT32_MAX;
+    }
+  }
+  ASSERT_TRUE(same);
+  ASSERT_EQ_U(num_hits, ref_hits);
+  ASSERT_TRUE(num_hits > 0);
+
+  // any number of workers writes the same records
+  struct GridTr_batch_hit_s *par_hits =
+      GridTr_new(N * sizeof(struct GridTr_batch_hit_s));
+  struct GridTr_thread_pool_s *pool = GridTr_create_thread_pool(4);
+  ASSERT_EQ_U(GridTr_trace_batch_parallel(pool, &g, ox, oy, oz, dx, dy, dz,
+                                          len, N, par_hits),
+              num_hits);
+  ASSERT_TRUE(memcmp(par_hits, hits, N * sizeof(*hits)) == 0);
+  GridTr_destroy_thread_pool(&pool);
+  GridTr_free(par_hits);
+  GridTr_free(hits);
+  GridTr_free(segs);
+  GridTr_free(soa);
+  GridTr_destroy_grid(&g);
+}
+
+static void test_raycast_any(void) {
+  struct GridTr_grid_s g;
+  query_build_walls(&g);
+
+  struct GridTr_rayseg_s seg = GridTr_create_rayseg(
+      vec3_set(0.25f, 0.5f, 0.5f), vec3_set(20.0f, 0.5f, 0.5f));
+  ASSERT_TRUE(GridTr_raycast_any(&g, &seg));
+  seg = GridTr_create_rayseg(vec3_set(0.25f, 0.5f, 0.5f),
+                             vec3_set(5.0f, 0.5f, 0.5f));
+  ASSERT_FALSE(GridTr_raycast_any(&g, &seg));
+  seg = GridTr_create_rayseg(vec3_set(0.25f, 3.5f, 0.5f),
+                             vec3_set(20.0f, 3.5f, 0.5f));
+  ASSERT_FALSE(GridTr_raycast_any(&g, &seg));
+  GridTr_destroy_grid(&g);
+
+  // must agree with the closest hit query
+  query_load_colliders_obj(&g);
+  uint32 rng = 777;
+  for (int i = 0; i < 2000; i++) {
+    struct vec3_s p0 = vec3_set(test_randf(&rng, -4.0f, 5.0f),
+                                test_randf(&rng, -2.0f, 4.0f),
+                                test_randf(&rng, -2.0f, 5.0f));
+    struct vec3_s p1 = vec3_set(test_randf(&rng, -4.0f, 5.0f),
+                                test_randf(&rng, -2.0f, 4.0f),
+                                test_randf(&rng, -2.0f, 5.0f));
+    struct GridTr_rayseg_s seg = GridTr_create_rayseg(p0, p1);
+    struct GridTr_hit_s hit;
+    ASSERT_EQ_I(GridTr_raycast_any(&g, &seg),
+                GridTr_raycast_closest(&g, &seg, &hit));
+  }
+  GridTr_destroy_grid(&g);
+
+  // short segments grazing a quad on z = 0 barely change their plane
+  // distance end to end, the two queries still have to agree
+  GridTr_create_grid(&g, 1.0f);
+  struct vec3_s ps[4] = {{{{0.0f, 0.0f, 0.0f}}},
+                         {{{1.0f, 0.0f, 0.0f}}},
+                         {{{1.0f, 1.0f, 0.0f}}},
+                         {{{0.0f, 1.0f, 0.0f}}}};
+  struct GridTr_collider_s coll;
+  GridTr_create_collider(&coll, 0, ps, 4,
+                         GridTr_create_plane(vec3_set(0.0f, 0.0f, 1.0f),
+                                             ps[0]));
+  GridTr_add_collider_to_grid(&g, &coll);
+  GridTr_destroy_collider(&coll);
+  struct GridTr_hit_s hit;
+  seg = GridTr_create_rayseg(vec3_set(0.5f, 0.5f, 4e-7f),
+                             vec3_set(0.9f, 0.5f, -4e-7f));
+  ASSERT_TRUE(GridTr_raycast_closest(&g, &seg, &hit));
+  ASSERT_TRUE(GridTr_raycast_any(&g, &seg));
+  bool same = true;
+  for (int i = 0; i < 2000; i++) {
+    float len = test_randf(&rng, 1e-3f, 0.5f);
+    float dz = test_randf(&rng, -2e-6f, 2e-6f);
+    struct vec3_s p0 = vec3_set(test_randf(&rng, 0.0f, 1.0f),
+                                test_randf(&rng, 0.0f, 1.0f), dz);
+    float a = test_randf(&rng, 0.0f, 6.2831853f);
+    struct vec3_s p1 = vec3_set(p0.x + len * cosf(a), p0.y + len * sinf(a),
+                                -dz + test_randf(&rng, -1e-6f, 1e-6f));
+    seg = GridTr_create_rayseg(p0, p1);
+    same = same && GridTr_raycast_any(&g, &seg) ==
+                       GridTr_raycast_closest(&g, &seg, &hit);
+  }
+  ASSERT_TRUE(same);
+  GridTr_destroy_grid(&g);
+}
+
+static void test_raycast_frozen_grid(void) {
+  struct GridTr_grid_s ref, g;
+  query_load_colliders_obj(&ref);
+  query_load_colliders_obj(&g);
+  GridTr_grid_freeze(&g);
+  uint32 rng = 4242;
+  for (int i = 0; i < 1000; i++) {
+    struct vec3_s p0 = vec3_set(test_randf(&rng, -4.0f, 5.0f),
+                                test_randf(&rng, -2.0f, 4.0f),
+                                test_randf(&rng, -2.0f, 5.0f));
+    struct vec3_s p1 = vec3_set(test_randf(&rng, -4.0f, 5.0f),
+                                test_randf(&rng, -2.0f, 4.0f),
+                                test_randf(&rng, -2.0f, 5.0f));
+    struct GridTr_rayseg_s seg = GridTr_create_rayseg(p0, p1);
+    struct GridTr_hit_s a, b;
+    bool hit_a = GridTr_raycast_closest(&ref, &seg, &a);
+    ASSERT_EQ_I(GridTr_raycast_closest(&g, &seg, &b), hit_a);
+    if (hit_a)
+      ASSERT_EQ_U(b.collider_idx, a.collider_idx);
+  }
+  GridTr_destroy_grid(&ref);
+  GridTr_destroy_grid(&g);
+}
+
+static void test_spherecast_walls(void) {
+  struct GridTr_grid_s g;
+  query_build_walls(&g);
+  struct GridTr_hit_s hit;
+
+  // clear of the small wall, face contact on the big one
+  struct GridTr_sphere_s sphere = {vec3_set(0.0f, -1.0f, -1.0f), 0.5f};
+  ASSERT_TRUE(GridTr_spherecast(&g, &sphere, vec3_set(20.0f, -1.0f, -1.0f),
+                                &hit));
+  ASSERT_EQ_U(hit.collider_idx, 0);
+  ASSERT_FEQ(hit.t, 9.5f);
+  ASSERT_V3EQ(hit.n, vec3_set(-1.0f, 0.0f, 0.0f));
+  ASSERT_V3EQ(hit.p, vec3_set(10.0f, -1.0f, -1.0f));
+
+  // a thin ray slips past the small wall's y = 0 edge, the sphere catches it
+  sphere.c = vec3_set(0.0f, -0.3f, 1.0f);
+  struct GridTr_rayseg_s seg =
+      GridTr_create_rayseg(sphere.c, vec3_set(20.0f, -0.3f, 1.0f));
+  ASSERT_TRUE(GridTr_raycast_closest(&g, &seg, &hit));
+  ASSERT_EQ_U(hit.collider_idx, 0);
+  ASSERT_TRUE(GridTr_spherecast(&g, &sphere, seg.e, &hit));
+  ASSERT_EQ_U(hit.collider_idx, 1);
+  ASSERT_FEQ(hit.t, 5.1f);
+  ASSERT_V3EQ(hit.n, vec3_set(-0.8f, -0.6f, 0.0f));
+  ASSERT_V3EQ(hit.p, vec3_set(5.5f, 0.0f, 1.0f));
+
+  // corner
+  sphere.c = vec3_set(0.0f, -0.3f, -0.3f);
+  ASSERT_TRUE(GridTr_spherecast(&g, &sphere, vec3_set(20.0f, -0.3f, -0.3f),
+                                &hit));
+  ASSERT_EQ_U(hit.collider_idx, 1);
+  ASSERT_FEQ(hit.t, 5.5f - sqrtf(0.25f - 0.18f));
+  ASSERT_V3EQ(hit.p, vec3_set(5.5f, 0.0f, 0.0f));
+
+  // starting in contact, and stopping short
+  sphere.c = vec3_set(5.2f, 1.0f, 1.0f);
+  ASSERT_TRUE(GridTr_spherecast(&g, &sphere, vec3_set(0.0f, 1.0f, 1.0f), &hit));
+  ASSERT_FEQ(hit.t, 0.0f);
+  ASSERT_V3EQ(hit.n, vec3_set(-1.0f, 0.0f, 0.0f));
+  sphere.c = vec3_set(0.0f, 1.0f, 1.0f);
+  ASSERT_FALSE(GridTr_spherecast(&g, &sphere, vec3_set(4.9f, 1.0f, 1.0f), &hit));
+  GridTr_destroy_grid(&g);
+}
+
+static void test_spherecast_matches_brute_force(void) {
+  struct GridTr_grid_s g;
+  query_load_colliders_obj(&g);
+  uint32 rng = 777;
+  int hits = 0;
+  bool same = true;
+  for (int i = 0; i < 1000; i++) {
+    // every fourth sphere spans several cells each way
+    struct GridTr_sphere_s sphere = {
+        vec3_set(test_randf(&rng, -4.0f, 5.0f), test_randf(&rng, -2.0f, 4.0f),
+                 test_randf(&rng, -2.0f, 5.0f)),
+        test_randf(&rng, 0.05f, i % 4 == 3 ? 4.0f : 1.5f)};
+    struct vec3_s to =
+        vec3_set(test_randf(&rng, -4.0f, 5.0f), test_randf(&rng, -2.0f, 4.0f),
+                 test_randf(&rng, -2.0f, 5.0f));
+    struct GridTr_rayseg_s seg = GridTr_create_rayseg(sphere.c, to);
+    float ref_t = FLT_MAX;
+    for (uint32 k = 0; k < g.colliders->num_elems; k++) {
+      float t;
+      struct vec3_s n;
+      if (GridTr_sweep_sphere_collider(GridTr_array_get_ro(g.colliders, k),
+                                       &seg, sphere.radius, &t, &n))
+        ref_t = MIN(ref_t, t);
+    }
+    struct GridTr_hit_s hit;
+    bool got = GridTr_spherecast(&g, &sphere, to, &hit);
+    same = same && got == (ref_t < FLT_MAX);
+    if (got) {
+      same = same && fabsf(hit.t - ref_t) <= TOL;
+      hits++;
+    }
+  }
+  ASSERT_TRUE(same);
+  ASSERT_TRUE(hits > 100);
+  GridTr_destroy_grid(&g);
+}
+
+static void test_query_aabb(void) {
+  struct GridTr_grid_s g;
+  query_load_colliders_obj(&g);
+  struct GridTr_visit_set_s visited;
+  GridTr_create_visit_set(&visited);
+  uint32 out[64];
+  uint32 rng = 31;
+  bool same = true;
+  uint32 total = 0;
+  const uint32 *stamps = NULL;
+  for (int i = 0; i < 500; i++) {
+    struct vec3_s c = vec3_set(test_randf(&rng, -4.0f, 5.0f),
+                               test_randf(&rng, -2.0f, 4.0f),
+                               test_randf(&rng, -2.0f, 5.0f));
+    struct vec3_s h = vec3_set(test_randf(&rng, 0.1f, 3.0f),
+                               test_randf(&rng, 0.1f, 3.0f),
+                               test_randf(&rng, 0.1f, 3.0f));
+    struct GridTr_aabb_s box;
+    GridTr_aabb_init(&box, vec3_sub(c, h), vec3_add(c, h));
+    uint32 n = GridTr_grid_query_aabb(&g, &box, &visited, out, 64);
+    // no allocation after the first query
+    if (i == 0)
+      stamps = visited.stamps;
+    same = same && visited.stamps == stamps;
+
+    uint32 ref = 0;
+    for (uint32 k = 0; k < g.colliders->num_elems; k++) {
+      if (!GridTr_collider_touches_aabb(GridTr_array_get_ro(g.colliders, k),
+                                        &box))
+        continue;
+      ref++;
+      uint32 found = 0;
+      for (uint32 j = 0; j < n; j++)
+        found += out[j] == k ? 1 : 0;
+      same = same && found == 1; // present, and only once
+    }
+    same = same && n == ref;
+    total += n;
+  }
+  ASSERT_TRUE(same);
+  ASSERT_TRUE(total > 500);
+
+  // a short buffer still reports the full count
+  struct GridTr_aabb_s all;
+  GridTr_aabb_init(&all, vec3_set(-10.0f, -10.0f, -10.0f),
+                   vec3_set(10.0f, 10.0f, 10.0f));
+  ASSERT_EQ_U(GridTr_grid_query_aabb(&g, &all, &visited, out, 3),
+              g.colliders->num_elems);
+  GridTr_destroy_visit_set(&visited);
+  GridTr_destroy_grid(&g);
+}
+
+static void test_query_obb(void) {
+  struct GridTr_grid_s g;
+  query_load_colliders_obj(&g);
+  struct GridTr_visit_set_s visited;
+  GridTr_create_visit_set(&visited);
+  uint32 out[64], out_aabb[64];
+  uint32 rng = 57;
+  bool same = true;
+  uint32 total = 0;
+  for (int i = 0; i < 500; i++) {
+    struct vec3_s o = vec3_set(test_randf(&rng, -4.0f, 5.0f),
+                               test_randf(&rng, -2.0f, 4.0f),
+                               test_randf(&rng, -2.0f, 5.0f));
+    struct vec3_s h = vec3_set(test_randf(&rng, 0.1f, 2.0f),
+                               test_randf(&rng, 0.1f, 2.0f),
+                               test_randf(&rng, 0.1f, 2.0f));
+    struct mat3_s rot = mat3_rot(vec3_set(test_randf(&rng, -3.1f, 3.1f),
+                                          test_randf(&rng, -3.1f, 3.1f),
+                                          test_randf(&rng, -3.1f, 3.1f)));
+    struct vec3_s axes[3] = {vec3_transf(rot, vec3_set(1.0f, 0.0f, 0.0f)),
+                             vec3_transf(rot, vec3_set(0.0f, 1.0f, 0.0f)),
+                             vec3_transf(rot, vec3_set(0.0f, 0.0f, 1.0f))};
+    uint32 n = GridTr_grid_query_obb(&g, o, axes, h, &visited, out, 64);
+    uint32 ref = 0;
+    for (uint32 k = 0; k < g.colliders->num_elems; k++) {
+      if (!GridTr_collider_touches_obb(GridTr_array_get_ro(g.colliders, k), o,
+                                       axes, h))
+        continue;
+      ref++;
+      uint32 found = 0;
+      for (uint32 j = 0; j < n; j++)
+        found += out[j] == k ? 1 : 0;
+      same = same && found == 1;
+    }
+    same = same && n == ref;
+    total += n;
+
+    // unrotated, it is the aabb query
+    struct vec3_s ident[3] = {vec3_set(1.0f, 0.0f, 0.0f),
+                              vec3_set(0.0f, 1.0f, 0.0f),
+                              vec3_set(0.0f, 0.0f, 1.0f)};
+    struct GridTr_aabb_s box;
+    GridTr_aabb_init(&box, vec3_sub(o, h), vec3_add(o, h));
+    n = GridTr_grid_query_obb(&g, o, ident, h, &visited, out, 64);
+    same = same && n == GridTr_grid_query_aabb(&g, &box, &visited, out_aabb, 64);
+  }
+  ASSERT_TRUE(same);
+  ASSERT_TRUE(total > 150);
+
+  // a thin diagonal slab whose enclosing aabb covers both walls
+  struct GridTr_grid_s walls;
+  query_build_walls(&walls);
+  float c = sqrtf(0.5f);
+  struct vec3_s axes[3] = {vec3_set(c, 0.0f, c), vec3_set(0.0f, 1.0f, 0.0f),
+                           vec3_set(-c, 0.0f, c)};
+  uint32 n = GridTr_grid_query_obb(&walls, vec3_set(10.0f, 1.0f, 0.0f), axes,
+                                   vec3_set(7.0f, 0.5f, 0.05f), &visited, out,
+                                   64);
+  ASSERT_EQ_U(n, 1);
+  ASSERT_EQ_U(out[0], 0);
+  struct GridTr_aabb_s box;
+  GridTr_aabb_init(&box, vec3_set(5.0f, 0.5f, -5.0f),
+                   vec3_set(15.0f, 1.5f, 5.0f));
+  ASSERT_EQ_U(GridTr_grid_query_aabb(&walls, &box, &visited, out, 64), 2);
+  GridTr_destroy_grid(&walls);
+
+  GridTr_destroy_visit_set(&visited);
+  GridTr_destroy_grid(&g);
+}
+
+static void test_closest_point(void) {
+  struct GridTr_grid_s g;
+  query_build_walls(&g);
+  struct GridTr_hit_s hit;
+  // over the small wall's face
+  ASSERT_TRUE(GridTr_grid_closest_point(&g, vec3_set(4.0f, 1.0f, 1.5f), 5.0f,
+                                        &hit));
+  ASSERT_EQ_U(hit.collider_idx, 1);
+  ASSERT_FEQ(hit.t, 1.5f);
+  ASSERT_V3EQ(hit.p, vec3_set(5.5f, 1.0f, 1.5f));
+  ASSERT_V3EQ(hit.n, vec3_set(-1.0f, 0.0f, 0.0f));
+  // past its bottom edge, the big wall is still further away
+  ASSERT_TRUE(GridTr_grid_closest_point(&g, vec3_set(6.5f, -1.0f, 1.0f), 5.0f,
+                                        &hit));
+  ASSERT_EQ_U(hit.collider_idx, 1);
+  ASSERT_FEQ(hit.t, sqrtf(2.0f));
+  ASSERT_V3EQ(hit.p, vec3_set(5.5f, 0.0f, 1.0f));
+  // on the big wall
+  ASSERT_TRUE(GridTr_grid_closest_point(&g, vec3_set(10.0f, -1.0f, -1.0f),
+                                        0.0f, &hit));
+  ASSERT_EQ_U(hit.collider_idx, 0);
+  ASSERT_FEQ(hit.t, 0.0f);
+  // max_dist is inclusive
+  ASSERT_FALSE(GridTr_grid_closest_point(&g, vec3_set(4.0f, 1.0f, 1.5f), 1.4f,
+                                         &hit));
+  ASSERT_TRUE(GridTr_grid_closest_point(&g, vec3_set(4.0f, 1.0f, 1.5f), 1.5f,
+                                        &hit));
+  ASSERT_FALSE(GridTr_grid_closest_point(&g, vec3_set(-20.0f, 0.0f, 0.0f),
+                                         20.0f, &hit));
+  // far off with a huge radius, the shells stop at the walls' bounds
+  ASSERT_TRUE(GridTr_grid_closest_point(&g, vec3_set(-1000.0f, 1.0f, 1.5f),
+                                        1.0e5f, &hit));
+  ASSERT_EQ_U(hit.collider_idx, 1);
+  ASSERT_FEQ(hit.t, 1005.5f);
+  ASSERT_FALSE(GridTr_grid_closest_point(&g, vec3_set(-1000.0f, 1.0f, 1.5f),
+                                         1000.0f, &hit));
+  GridTr_destroy_grid(&g);
+
+  query_load_colliders_obj(&g);
+  const struct GridTr_collider_s *colliders = g.colliders->data;
+  uint32 rng = 77;
+  bool same = true;
+  uint32 found = 0;
+  for (int i = 0; i < 300; i++) {
+    struct vec3_s p = vec3_set(test_randf(&rng, -6.0f, 7.0f),
+                               test_randf(&rng, -4.0f, 6.0f),
+                               test_randf(&rng, -4.0f, 7.0f));
+    float max_dist = test_randf(&rng, 0.0f, 6.0f);
+    float ref = FLT_MAX;
+    for (uint32 k = 0; k < g.colliders->num_elems; k++) {
+      struct vec3_s c = GridTr_collider_closest_point(&colliders[k], p);
+      ref = MIN(ref, vec3_len(point_vec(c, p)));
+    }
+    bool ok = GridTr_grid_closest_point(&g, p, max_dist, &hit);
+    same = same && ok == (ref <= max_dist);
+    if (ok) {
+      same = same && fabsf(hit.t - ref) < 1e-4f;
+      found++;
+    }
+  }
+  ASSERT_TRUE(same);
+  ASSERT_TRUE(found > 50);
+  GridTr_destroy_grid(&g);
+}
+
+// perspective frustum at eye looking along fwd, half_angle on all sides
+static void query_make_frustum(struct GridTr_plane_s *planes, struct vec3_s eye,
+                               struct vec3_s fwd, struct vec3_s up,
+                               float half_angle, float near, float far) {
+  fwd = vec3_norm(fwd);
+  struct vec3_s r = vec3_norm(vec3_cross(fwd, up));
+  struct vec3_s u = vec3_cross(r, fwd);
+  float c = cosf(half_angle), s = sinf(half_angle);
+  struct vec3_s fs = vec3_mul(fwd, s);
+  planes[GridTr_FRUSTUM_LEFT] =
+      GridTr_create_plane(vec3_add(vec3_mul(r, c), fs), eye);
+  planes[GridTr_FRUSTUM_RIGHT] =
+      GridTr_create_plane(vec3_add(vec3_mul(r, -c), fs), eye);
+  planes[GridTr_FRUSTUM_BOTTOM] =
+      GridTr_create_plane(vec3_add(vec3_mul(u, c), fs), eye);
+  planes[GridTr_FRUSTUM_TOP] =
+      GridTr_create_plane(vec3_add(vec3_mul(u, -c), fs), eye);
+  planes[GridTr_FRUSTUM_NEAR] =
+      GridTr_create_plane(fwd, vec3_add(eye, vec3_mul(fwd, near)));
+  planes[GridTr_FRUSTUM_FAR] = GridTr_create_plane(
+      vec3_mul(fwd, -1.0f), vec3_add(eye, vec3_mul(fwd, far)));
+}
+
+static void test_query_frustum(void) {
+  struct GridTr_grid_s g;
+  query_build_walls(&g);
+  struct GridTr_visit_set_s visited;
+  GridTr_create_visit_set(&visited);
+  struct GridTr_plane_s planes[GridTr_FRUSTUM_NUM_PLANES];
+  uint32 out[64];
+  query_make_frustum(planes, vec3_set(0.0f, 1.0f, 1.0f),
+                     vec3_set(1.0f, 0.0f, 0.0f), vec3_set(0.0f, 1.0f, 0.0f),
+                     0.1f, 0.5f, 7.0f);
+  ASSERT_EQ_U(GridTr_grid_query_frustum(&g, planes, &visited, out, 64), 1);
+  ASSERT_EQ_U(out[0], 1);
+  query_make_frustum(planes, vec3_set(0.0f, 1.0f, 1.0f),
+                     vec3_set(1.0f, 0.0f, 0.0f), vec3_set(0.0f, 1.0f, 0.0f),
+                     0.1f, 0.5f, 20.0f);
+  ASSERT_EQ_U(GridTr_grid_query_frustum(&g, planes, &visited, out, 64), 2);
+  query_make_frustum(planes, vec3_set(0.0f, 1.0f, 1.0f),
+                     vec3_set(-1.0f, 0.0f, 0.0f), vec3_set(0.0f, 1.0f, 0.0f),
+                     0.1f, 0.5f, 20.0f);
+  ASSERT_EQ_U(GridTr_grid_query_frustum(&g, planes, &visited, out, 64), 0);
+  GridTr_destroy_grid(&g);
+
+  query_load_colliders_obj(&g);
+  const struct GridTr_collider_s *colliders = g.colliders->data;
+  uint32 rng = 91;
+  bool same = true, box_same = true;
+  uint32 total = 0;
+  for (int i = 0; i < 200; i++) {
+    struct vec3_s eye = vec3_set(test_randf(&rng, -6.0f, 7.0f),
+                                 test_randf(&rng, -4.0f, 6.0f),
+                                 test_randf(&rng, -4.0f, 7.0f));
+    struct vec3_s fwd = vec3_set(test_randf(&rng, -1.0f, 1.0f),
+                                 test_randf(&rng, -1.0f, 1.0f),
+                                 test_randf(&rng, -1.0f, 1.0f));
+    if (vec3_lensq(fwd) < 0.01f)
+      continue;
+    struct vec3_s up = fabsf(fwd.y) > fabsf(fwd.x) ? vec3_set(1.0f, 0.0f, 0.0f)
+                                                   : vec3_set(0.0f, 1.0f, 0.0f);
+    query_make_frustum(planes, eye, fwd, up, test_randf(&rng, 0.1f, 0.7f),
+                       0.1f, test_randf(&rng, 1.0f, 8.0f));
+    uint32 n = GridTr_grid_query_frustum(&g, planes, &visited, out, 64);
+    struct GridTr_frustum_s frustum;
+    GridTr_frustum_init(&frustum, planes);
+    uint32 ref = 0;
+    for (uint32 k = 0; k < g.colliders->num_elems; k++) {
+      if (!GridTr_collider_touches_frustum(&colliders[k], &frustum))
+        continue;
+      ref++;
+      uint32 found = 0;
+      for (uint32 j = 0; j < n && j < 64; j++)
+        found += out[j] == k ? 1 : 0;
+      same = same && (found == 1 || n > 64);
+    }
+    same = same && n == ref;
+    total += n;
+
+    // a box is a frustum too, and must agree with the box SAT
+    struct vec3_s h = vec3_set(test_randf(&rng, 0.1f, 2.0f),
+                               test_randf(&rng, 0.1f, 2.0f),
+                               test_randf(&rng, 0.1f, 2.0f));
+    struct GridTr_aabb_s box;
+    GridTr_aabb_init(&box, vec3_sub(eye, h), vec3_add(eye, h));
+    for (int a = 0; a < 3; a++) {
+      struct vec3_s n = vec3_zero();
+      n.xyz[a] = 1.0f;
+      planes[2 * a] = GridTr_create_plane(n, box.min);
+      planes[2 * a + 1] = GridTr_create_plane(vec3_mul(n, -1.0f), box.max);
+    }
+    GridTr_frustum_init(&frustum, planes);
+    for (uint32 k = 0; k < g.colliders->num_elems; k++) {
+      box_same = box_same &&
+                 GridTr_collider_touches_frustum(&colliders[k], &frustum) ==
+                     GridTr_collider_touches_aabb(&colliders[k], &box);
+    }
+  }
+  ASSERT_TRUE(same);
+  ASSERT_TRUE(box_same);
+  ASSERT_TRUE(total > 50);
+
+  GridTr_destroy_visit_set(&visited);
+  GridTr_destroy_grid(&g);
+}
+
+void run_query_tests() {
+  printf("[query] begin tests:\n");
+  test_raycast_closest_walls();
+  test_raycast_closest_matches_brute_force();
+  test_raycast_all();
+  test_trace_batch();
+  test_raycast_any();
+  test_raycast_frozen_grid();
+  test_spherecast_walls();
+  test_spherecast_matches_brute_force();
+  test_query_aabb();
+  test_query_obb();
+  test_closest_point();
+  test_query_frustum();
+  printf("[query] tests run: %d, failed: %d\n", g_tests_run, g_tests_failed);
+}
@@ -37,6 +37,12 @@ static bool iv3eq(struct ivec3_s a, struct ivec3_s b) {
   return a.x == b.x && a.y == b.y && a.z == b.z;
 }
 
+// lcg, so tests get the same numbers everywhere. uniform in [lo, hi)
+static float test_randf(uint32 *state, float lo, float hi) {
+  *state = *state * 1664525u + 1013904223u;
+  return lo + (hi - lo) * (float)(*state >> 8) / (float)(1u << 24);
+}
+
 #define ASSERT_FEQ(a, b)                                                       \
   do {                                                                         \
     g_tests_run++;                                                             \
@@ -34,6 +34,22 @@ uint64 ivec3_fnv1a(struct ivec3_s v) {
   // return h;
 }
 
+// 3D Z-order code, cells within +/-2^20 of the origin
+uint64 ivec3_morton(struct ivec3_s v) {
+  // bias into 21 unsigned bits per axis, then interleave x/y/z bits
+  uint64 code = 0;
+  for (int i = 0; i < 3; i++) {
+    uint64 b = (uint64)((uint)v.xyz[i] + (1u << 20)) & 0x1fffffull;
+    b = (b | (b << 32)) & 0x1f00000000ffffull;
+    b = (b | (b << 16)) & 0x1f0000ff0000ffull;
+    b = (b | (b << 8)) & 0x100f00f00f00f00full;
+    b = (b | (b << 4)) & 0x10c30c30c30c30c3ull;
+    b = (b | (b << 2)) & 0x1249249249249249ull;
+    code |= b << i;
+  }
+  return code;
+}
+
 struct ivec3_s ivec3_min(struct ivec3_s a, struct ivec3_s b) {
   struct ivec3_s r;
   r.x = MIN(a.x, b.x);